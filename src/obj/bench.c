@@ -0,0 +1,672 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Micro-benchmarks of the reactor's main operations.  Each case is
+   run for a number of rounds, and the time per operation of each
+   round (or of each operation, where that can be measured) forms a
+   sample.  The mean and percentiles of the samples are reported, as
+   text or as one JSON object per line. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "react/types.h"
+#include "react/core.h"
+#include "react/event.h"
+#include "react/idle.h"
+#include "react/time.h"
+#include "react/fd.h"
+#include "react/socket.h"
+#include "react/stats.h"
+#include "react/version.h"
+
+static size_t rounds = 200;
+static size_t batch = 1000;
+static size_t nsocks = 500;
+static size_t nactive = 10;
+static size_t nprios = 4;
+static bool json;
+static const char *backend;
+static const char *const *only;
+
+struct samples {
+  const char *name;
+  size_t n, cap;
+  double *v;
+  unsigned long long ops, ns;
+};
+
+static unsigned long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void record(struct samples *s, unsigned long long ns,
+                   unsigned long long ops)
+{
+  if (ops == 0) return;
+  if (s->n == s->cap) {
+    size_t ncap = s->cap ? s->cap * 2 : 256;
+    double *nv = realloc(s->v, ncap * sizeof *nv);
+    if (nv == NULL) return;
+    s->v = nv;
+    s->cap = ncap;
+  }
+  s->v[s->n++] = (double) ns / ops;
+  s->ops += ops;
+  s->ns += ns;
+}
+
+static int cmp_double(const void *va, const void *vb)
+{
+  const double *a = va, *b = vb;
+  return *a < *b ? -1 : *a > *b;
+}
+
+static double pct(const struct samples *s, double p)
+{
+  size_t i = (size_t) (p / 100.0 * (s->n - 1) + 0.5);
+  return s->v[i];
+}
+
+static void report(struct samples *s)
+{
+  if (s->n == 0) {
+    fprintf(stderr, "%s: no samples\n", s->name);
+    return;
+  }
+  qsort(s->v, s->n, sizeof *s->v, &cmp_double);
+  double mean = (double) s->ns / s->ops;
+  if (json)
+    printf("{\"case\":\"%s\",\"backend\":\"%s\",\"version\":\"%d.%d.%d\","
+           "\"ops\":%llu,\"samples\":%zu,\"ns_per_op\":%.1f,"
+           "\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}\n",
+           s->name, backend, react_VERSION, react_MINOR, react_PATCHLEVEL,
+           s->ops, s->n, mean,
+           pct(s, 50), pct(s, 90), pct(s, 99), s->v[s->n - 1]);
+  else
+    printf("%-24s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+           s->name, s->ops, mean,
+           pct(s, 50), pct(s, 90), pct(s, 99), s->v[s->n - 1]);
+  fflush(stdout);
+}
+
+static bool wanted(const char *name)
+{
+  if (only == NULL || *only == NULL) return true;
+  for (const char *const *p = only; *p; p++)
+    if (!strncmp(name, *p, strlen(*p)))
+      return true;
+  return false;
+}
+
+static void init_samples(struct samples *s, const char *name)
+{
+  s->name = name;
+  s->n = s->cap = 0;
+  s->v = NULL;
+  s->ops = s->ns = 0;
+}
+
+static void finish(struct samples *s)
+{
+  report(s);
+  free(s->v);
+}
+
+static void noop(void *ctxt)
+{
+  (void) ctxt;
+}
+
+static size_t fired;
+
+static void count(void *ctxt)
+{
+  (void) ctxt;
+  fired++;
+}
+
+static int drain(react_core_t core, size_t target)
+{
+  while (fired < target)
+    if (react_yield(core) < 0 && errno != EINTR) {
+      perror("react_yield");
+      return -1;
+    }
+  return 0;
+}
+
+static void far_future(struct timespec *ts, long offset)
+{
+  clock_gettime(CLOCK_REALTIME, ts);
+  ts->tv_sec += 3600 + offset / 1000000000;
+  ts->tv_nsec += offset % 1000000000;
+  if (ts->tv_nsec >= 1000000000) {
+    ts->tv_nsec -= 1000000000;
+    ts->tv_sec++;
+  }
+}
+
+
+
+static void bench_openclose(react_core_t core)
+{
+  struct samples s;
+  init_samples(&s, "open-close");
+  for (size_t r = 0; r < rounds; r++) {
+    unsigned long long t0 = now_ns();
+    for (size_t i = 0; i < batch; i++)
+      react_close(react_open(core));
+    record(&s, now_ns() - t0, batch);
+  }
+  finish(&s);
+}
+
+enum { C_IDLE, C_TIMER, C_FDIN, C_SOCKIN };
+
+static void bench_primecancel(react_core_t core, int type,
+                              const char *name)
+{
+  if (!wanted(name)) return;
+
+  int fds[2] = { -1, -1 };
+  if (type == C_FDIN && pipe(fds) < 0) {
+    perror("pipe");
+    return;
+  }
+  if (type == C_SOCKIN && socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    perror("socketpair");
+    return;
+  }
+  struct timespec when;
+  far_future(&when, 0);
+
+  react_t h = react_open(core);
+  react_direct(h, &noop, NULL);
+  struct samples s;
+  init_samples(&s, name);
+  for (size_t r = 0; r < rounds; r++) {
+    unsigned long long t0 = now_ns();
+    for (size_t i = 0; i < batch; i++) {
+      int rc;
+      switch (type) {
+      case C_IDLE:
+        rc = react_prime_idle(h);
+        break;
+      case C_TIMER:
+        rc = react_prime_timespec(h, &when);
+        break;
+      case C_FDIN:
+        rc = react_prime_fdin(h, fds[0]);
+        break;
+      default:
+        rc = react_prime_sockin(h, fds[0]);
+        break;
+      }
+      if (rc < 0) {
+        perror(name);
+        goto end;
+      }
+      react_cancel(h);
+    }
+    record(&s, now_ns() - t0, batch);
+  }
+ end:
+  finish(&s);
+  react_close(h);
+  if (fds[0] >= 0) close(fds[0]);
+  if (fds[1] >= 0) close(fds[1]);
+}
+
+static void bench_timers(react_core_t core, size_t pop)
+{
+  char churn_name[40], fire_name[40];
+  snprintf(churn_name, sizeof churn_name, "timer-churn-%zu", pop);
+  snprintf(fire_name, sizeof fire_name, "timer-fire-%zu", pop);
+  if (!wanted(churn_name) && !wanted(fire_name)) return;
+
+  /* Populate the heap with timers that will never go off. */
+  react_t *bg = malloc((pop + batch) * sizeof *bg);
+  if (bg == NULL) {
+    perror("malloc");
+    return;
+  }
+  react_t *fg = bg + pop;
+  for (size_t i = 0; i < pop; i++) {
+    struct timespec when;
+    far_future(&when, (long) i * 1000);
+    bg[i] = react_open(core);
+    react_direct(bg[i], &noop, NULL);
+    react_prime_timespec(bg[i], &when);
+  }
+  for (size_t i = 0; i < batch; i++) {
+    fg[i] = react_open(core);
+    react_direct(fg[i], &count, NULL);
+  }
+
+  if (wanted(churn_name)) {
+    /* Insert and remove one timer, landing amid the others. */
+    struct samples s;
+    init_samples(&s, churn_name);
+    for (size_t r = 0; r < rounds; r++) {
+      struct timespec when;
+      far_future(&when, (long) (r * 7919 % (pop + 1)) * 1000 + 500);
+      unsigned long long t0 = now_ns();
+      for (size_t i = 0; i < batch; i++) {
+        react_prime_timespec(fg[0], &when);
+        react_cancel(fg[0]);
+      }
+      record(&s, now_ns() - t0, batch);
+    }
+    finish(&s);
+  }
+
+  if (wanted(fire_name)) {
+    /* Prime a batch of overdue timers, and time their dispatch. */
+    struct samples s;
+    init_samples(&s, fire_name);
+    for (size_t r = 0; r < rounds; r++) {
+      struct timespec when;
+      clock_gettime(CLOCK_REALTIME, &when);
+      when.tv_sec--;
+      unsigned long long t0 = now_ns();
+      for (size_t i = 0; i < batch; i++)
+        react_prime_timespec(fg[i], &when);
+      fired = 0;
+      if (drain(core, batch) < 0) break;
+      record(&s, now_ns() - t0, batch);
+    }
+    finish(&s);
+  }
+
+  for (size_t i = 0; i < pop + batch; i++)
+    react_close(bg[i]);
+  free(bg);
+}
+
+struct sockrec {
+  react_t h;
+  int fd[2];
+};
+
+static void on_sock(void *ctxt)
+{
+  struct sockrec *sr = ctxt;
+  char c;
+  if (read(sr->fd[0], &c, 1) < 0)
+    perror("read");
+  fired++;
+  react_prime_sockin(sr->h, sr->fd[0]);
+}
+
+static void bench_sockets(react_core_t core)
+{
+  char name[60];
+  snprintf(name, sizeof name, "sockets-%zu-%zu", nsocks, nactive);
+  if (!wanted(name)) return;
+
+  struct sockrec *sr = calloc(nsocks, sizeof *sr);
+  if (sr == NULL) {
+    perror("calloc");
+    return;
+  }
+  size_t n;
+  for (n = 0; n < nsocks; n++) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sr[n].fd) < 0) {
+      perror("socketpair");
+      goto end;
+    }
+    sr[n].h = react_open(core);
+    react_direct(sr[n].h, &on_sock, &sr[n]);
+    if (react_prime_sockin(sr[n].h, sr[n].fd[0]) < 0) {
+      perror("react_prime_sockin");
+      n++;
+      goto end;
+    }
+  }
+
+  /* Make a few of the pairs readable, and time how long it takes to
+     dispatch them all. */
+  struct samples s;
+  init_samples(&s, name);
+  size_t k = nactive < nsocks ? nactive : nsocks;
+  size_t next = 0;
+  for (size_t r = 0; r < rounds; r++) {
+    for (size_t i = 0; i < k; i++) {
+      next = (next + 7919) % nsocks;
+      if (write(sr[next].fd[1], "x", 1) < 0)
+        perror("write");
+    }
+    fired = 0;
+    unsigned long long t0 = now_ns();
+    if (drain(core, k) < 0) break;
+    record(&s, now_ns() - t0, k);
+  }
+  finish(&s);
+
+ end:
+  while (n-- > 0) {
+    react_close(sr[n].h);
+    close(sr[n].fd[0]);
+    close(sr[n].fd[1]);
+  }
+  free(sr);
+}
+
+struct pinger {
+  react_t h;
+  int fd;
+  size_t *hops, target;
+  unsigned long long *last;
+  struct samples *s;
+};
+
+static void on_ping(void *ctxt)
+{
+  struct pinger *p = ctxt;
+  char c;
+  if (read(p->fd, &c, 1) < 0)
+    perror("read");
+  unsigned long long t = now_ns();
+  record(p->s, t - *p->last, 1);
+  *p->last = t;
+  if (++*p->hops >= p->target) return;
+  if (write(p->fd, &c, 1) < 0)
+    perror("write");
+  react_prime_sockin(p->h, p->fd);
+}
+
+static void bench_pingpong(react_core_t core)
+{
+  if (!wanted("ping-pong")) return;
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    perror("socketpair");
+    return;
+  }
+
+  /* Each hop from one handle to the other is timed separately. */
+  struct samples s;
+  init_samples(&s, "ping-pong");
+  size_t hops;
+  unsigned long long last;
+  struct pinger p[2];
+  for (int i = 0; i < 2; i++) {
+    p[i].h = react_open(core);
+    p[i].fd = fds[i];
+    p[i].hops = &hops;
+    p[i].target = batch;
+    p[i].last = &last;
+    p[i].s = &s;
+    react_direct(p[i].h, &on_ping, &p[i]);
+  }
+  for (size_t r = 0; r < rounds; r++) {
+    hops = 0;
+    react_prime_sockin(p[0].h, fds[0]);
+    react_prime_sockin(p[1].h, fds[1]);
+    last = now_ns();
+    if (write(fds[1], "x", 1) < 0) {
+      perror("write");
+      break;
+    }
+    while (hops < batch)
+      if (react_yield(core) < 0 && errno != EINTR) {
+        perror("react_yield");
+        goto end;
+      }
+    react_cancel(p[0].h);
+    react_cancel(p[1].h);
+  }
+ end:
+  finish(&s);
+  for (int i = 0; i < 2; i++) {
+    react_close(p[i].h);
+    close(fds[i]);
+  }
+}
+
+static void bench_prios(react_core_t core)
+{
+  char name[40];
+  snprintf(name, sizeof name, "multi-prio-%zu", nprios);
+  if (!wanted(name)) return;
+
+  /* Spread the handles over the priorities, and trigger them all at
+     once.  Each yield only processes the highest non-empty
+     priority. */
+  react_t *h = malloc(batch * sizeof *h);
+  if (h == NULL) {
+    perror("malloc");
+    return;
+  }
+  for (size_t i = 0; i < batch; i++) {
+    h[i] = react_open(core);
+    react_direct(h[i], &count, NULL);
+    if (react_setprios(h[i], i % nprios, 0) < 0)
+      perror("react_setprios");
+  }
+  struct samples s;
+  init_samples(&s, name);
+  for (size_t r = 0; r < rounds; r++) {
+    unsigned long long t0 = now_ns();
+    for (size_t i = 0; i < batch; i++)
+      react_trigger(h[i]);
+    fired = 0;
+    if (drain(core, batch) < 0) break;
+    record(&s, now_ns() - t0, batch);
+  }
+  finish(&s);
+  for (size_t i = 0; i < batch; i++)
+    react_close(h[i]);
+  free(h);
+}
+
+struct greedy {
+  react_t rx, tm;
+  int fd;
+  char c;
+  react_ssize_t rc;
+  int en;
+  bool due;
+};
+
+static void on_greedy(void *ctxt)
+{
+  struct greedy *g = ctxt;
+  if (g->rc <= 0) return;
+  react_prime_recv(g->rx, g->fd, &g->c, 1, 0, &g->rc, &g->en);
+}
+
+static void on_due(void *ctxt)
+{
+  struct greedy *g = ctxt;
+  g->due = true;
+}
+
+static void bench_greedy(react_core_t core)
+{
+  if (!wanted("greedy-timer")) return;
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) {
+    perror("socketpair");
+    return;
+  }
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+
+  /* One handle receives a byte at a time from a full socket, and
+     optimistically re-primes itself, while a timer is due in 1ms.
+     Each sample is how late the timer is. */
+  const long delay = 1000000;
+  struct samples s;
+  init_samples(&s, "greedy-timer");
+  struct greedy g;
+  g.fd = fds[0];
+  g.rx = react_open(core);
+  g.tm = react_open(core);
+  react_direct(g.rx, &on_greedy, &g);
+  react_direct(g.tm, &on_due, &g);
+  react_optimistic(g.rx, 1);
+  static char fill[65536];
+  for (size_t r = 0; r < rounds; r++) {
+    while (write(fds[1], fill, sizeof fill) > 0)
+      ;
+    struct timespec when;
+    clock_gettime(CLOCK_REALTIME, &when);
+    when.tv_nsec += delay;
+    if (when.tv_nsec >= 1000000000) {
+      when.tv_nsec -= 1000000000;
+      when.tv_sec++;
+    }
+    g.due = false;
+    react_prime_timespec(g.tm, &when);
+    unsigned long long t0 = now_ns();
+    react_prime_recv(g.rx, g.fd, &g.c, 1, 0, &g.rc, &g.en);
+    while (!g.due)
+      if (react_yield(core) < 0 && errno != EINTR) {
+        perror("react_yield");
+        goto end;
+      }
+    unsigned long long t = now_ns() - t0;
+    record(&s, t > delay ? t - delay : 0, 1);
+    react_cancel(g.rx);
+    while (read(fds[0], fill, sizeof fill) > 0)
+      ;
+  }
+ end:
+  finish(&s);
+  react_close(g.rx);
+  react_close(g.tm);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-j] [-b backend] [-r rounds] [-n batch]"
+          " [-N socks] [-K active] [-P prios] [case-prefix...]\n", prog);
+}
+
+int main(int argc, char *const *argv)
+{
+  const char *want_backend = NULL;
+  int c;
+  while ((c = getopt(argc, argv, "jb:r:n:N:K:P:")) != -1) {
+    switch (c) {
+    case 'j':
+      json = true;
+      break;
+    case 'b':
+      want_backend = optarg;
+      break;
+    case 'r':
+      rounds = strtoul(optarg, NULL, 0);
+      break;
+    case 'n':
+      batch = strtoul(optarg, NULL, 0);
+      break;
+    case 'N':
+      nsocks = strtoul(optarg, NULL, 0);
+      break;
+    case 'K':
+      nactive = strtoul(optarg, NULL, 0);
+      break;
+    case 'P':
+      nprios = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (rounds == 0 || batch == 0 || nsocks == 0 || nprios == 0 ||
+      nprios > react_MAXPRIOS) {
+    usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  only = (const char *const *) argv + optind;
+
+  react_core_t core = react_opencore(0);
+  if (core == react_COREERROR) {
+    perror("react_opencore");
+    return EXIT_FAILURE;
+  }
+
+  /* The backend is chosen when the library is built, so we can only
+     check that it is the one expected. */
+  struct react_stats st;
+  react_getstats(core, &st);
+  backend = st.backend;
+  if (want_backend && strcmp(want_backend, backend)) {
+    fprintf(stderr, "%s: built for %s, not %s\n",
+            argv[0], backend, want_backend);
+    return EXIT_FAILURE;
+  }
+
+  /* Make room for the socket pairs. */
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < nsocks * 2 + 16) {
+    rl.rlim_cur = nsocks * 2 + 16;
+    if (rl.rlim_cur > rl.rlim_max)
+      rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  if (!json)
+    printf("# backend %s, %zu rounds of %zu\n"
+           "%-24s %10s %10s %10s %10s %10s %10s\n",
+           backend, rounds, batch,
+           "case", "ops", "ns/op", "p50", "p90", "p99", "max");
+
+  if (wanted("open-close"))
+    bench_openclose(core);
+  bench_primecancel(core, C_IDLE, "prime-cancel-idle");
+  bench_primecancel(core, C_TIMER, "prime-cancel-timer");
+  bench_primecancel(core, C_FDIN, "prime-cancel-fdin");
+  bench_primecancel(core, C_SOCKIN, "prime-cancel-sockin");
+  static const size_t pops[] = { 0, 1000, 100000 };
+  for (size_t i = 0; i < sizeof pops / sizeof pops[0]; i++)
+    bench_timers(core, pops[i]);
+  bench_sockets(core);
+  bench_pingpong(core);
+  bench_prios(core);
+  bench_greedy(core);
+
+  react_closecore(core);
+  return EXIT_SUCCESS;
+}
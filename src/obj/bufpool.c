@@ -0,0 +1,109 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "common.h"
+#include "react/bufpool.h"
+
+struct react_bufpoolstr {
+  size_t bufsize, keep;
+
+  /* These are the returned buffers available for reuse. */
+  struct react_buf *free;
+  size_t idle;
+};
+
+react_bufpool_t react_openbufpool(size_t bufsize, size_t keep)
+{
+  if (bufsize == 0) {
+    errno = EINVAL;
+    return react_BUFPOOLERROR;
+  }
+  struct react_bufpoolstr *pool = malloc(sizeof *pool);
+  if (pool == NULL) {
+    errno = react_ENOMEM;
+    return react_BUFPOOLERROR;
+  }
+  pool->bufsize = bufsize;
+  pool->keep = keep;
+  pool->free = NULL;
+  pool->idle = 0;
+  return pool;
+}
+
+void react_closebufpool(react_bufpool_t pool)
+{
+  if (pool == react_BUFPOOLERROR) return;
+  while (pool->free != NULL) {
+    struct react_buf *b = pool->free;
+    pool->free = b->next;
+    free(b);
+  }
+  free(pool);
+}
+
+struct react_buf *react_getbuf(react_bufpool_t pool)
+{
+  struct react_buf *b = pool->free;
+  if (b != NULL) {
+    pool->free = b->next;
+    pool->idle--;
+  } else {
+    /* The data follow the header in the same block. */
+    b = malloc(sizeof *b + pool->bufsize);
+    if (b == NULL) {
+      errno = react_ENOMEM;
+      return NULL;
+    }
+    b->base = (unsigned char *) (b + 1);
+    b->cap = pool->bufsize;
+  }
+  b->next = NULL;
+  b->len = 0;
+  return b;
+}
+
+void react_putbufs(react_bufpool_t pool, struct react_buf *b)
+{
+  while (b != NULL) {
+    struct react_buf *next = b->next;
+    if (pool->idle < pool->keep) {
+      b->next = pool->free;
+      pool->free = b;
+      pool->idle++;
+    } else {
+      free(b);
+    }
+    b = next;
+  }
+}
+
+size_t react_chainlen(const struct react_buf *b)
+{
+  size_t sum = 0;
+  for ( ; b != NULL; b = b->next)
+    sum += b->len;
+  return sum;
+}
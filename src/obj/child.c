@@ -0,0 +1,116 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <errno.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/fd.h"
+#include "react/child.h"
+
+#if react_ALLOW_PIDFD
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+/* Convert the outcome of waitid() into a waitpid() status. */
+static int wait_status(const siginfo_t *info)
+{
+  switch (info->si_code) {
+  case CLD_EXITED:
+    return (info->si_status & 0xff) << 8;
+  case CLD_KILLED:
+    return info->si_status & 0x7f;
+  case CLD_DUMPED:
+    return (info->si_status & 0x7f) | 0x80;
+  default:
+    return 0;
+  }
+}
+
+static void defuse_child(struct react_reg *r)
+{
+  close(r->data.child.fd);
+}
+
+static void on_ended(void *ctxt)
+{
+  struct react_reg *r = ctxt;
+
+  /* Reap exactly this child. */
+  siginfo_t info;
+  info.si_pid = 0;
+  if (waitid((idtype_t) P_PIDFD, r->data.child.fd, &info,
+             WEXITED | WNOHANG) < 0) {
+    *r->data.child.en = errno;
+  } else if (info.si_pid == 0) {
+    /* It hasn't ended after all. */
+    if (react_prime_fdin(r->subev, r->data.child.fd) == 0)
+      return;
+    *r->data.child.en = errno;
+  } else {
+    *r->data.child.status = wait_status(&info);
+    *r->data.child.en = 0;
+  }
+  react_trigger(r);
+}
+
+int react_prime_child(struct react_reg *r, pid_t pid, int *status, int *en)
+{
+  react_cancel(r);
+
+#ifdef SYS_pidfd_open
+  struct react_reg *sub = react_ensuresub(r);
+  if (sub == react_ERROR) return -1;
+
+  int fd = syscall(SYS_pidfd_open, pid, 0);
+  if (fd < 0) return -1;
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  react_direct(sub, &on_ended, r);
+  react_setprios(sub, r->prio, r->subprio);
+  if (react_prime_fdin(sub, fd) < 0) {
+    int tmp = errno;
+    close(fd);
+    errno = tmp;
+    return -1;
+  }
+
+  r->data.child.fd = fd;
+  r->data.child.status = status;
+  r->data.child.en = en;
+  r->act = &react_trigger;
+  r->defuse = &defuse_child;
+  return 0;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+#endif
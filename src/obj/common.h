@@ -29,12 +29,24 @@
 #define common_HDRINCLUDED
 
 #include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 
 #include <ddslib/dllist.h>
 #include <ddslib/bheap.h>
 
 #include "features.h"
 #include "react/types.h"
+#include "react/stats.h"
+#include "react/trace.h"
+
+#if react_ALLOW_SIGNALFD
+#include <signal.h>
+#endif
+
+#if react_ALLOW_INOTIFY
+#include <stdint.h>
+#endif
 
 #define FDSEARCH_LIST 0
 #define FDSEARCH_HASH 1
@@ -65,6 +77,10 @@ struct queue_set {
 
 #define SIZEOFARR(A) (sizeof (A) / sizeof (A)[0])
 
+struct react_profile {
+  struct react_hist proc[react_MAXPRIOS];
+};
+
 #if ARRAY_LIMIT
 struct arrref {
   index_type next, prev;
@@ -92,6 +108,8 @@ struct react_reg {
      handle in a queue, i.e. (*proc)(proc_data). */
   react_proc_t *proc;
   void *proc_data;
+  /* This identifies the handle in diagnostics. */
+  const char *label;
   /* This emulates proactor behaviour.  It is executed as soon as the
      event is detected. */
   action_proc_t *act;
@@ -105,6 +123,38 @@ struct react_reg {
   react_subprio_t subprio;
   dllist_elem(struct react_reg) in_queue;
   unsigned queued : 1;
+  /* A queued handle that completed optimistically while the core was
+     dispatching is held in a separate list until the next yield. */
+  unsigned deferred : 1;
+  /* This is when the core woke to find the handle queued.  If the
+     handle was queued while the core was not dispatching, it is also
+     in a list of handles to be stamped when the core next wakes. */
+  moment_type queued_at;
+  dllist_elem(struct react_reg) in_fresh;
+  unsigned fresh : 1;
+  /* Proactor-style priming first attempts the operation. */
+  unsigned optimistic : 1;
+  /* The library opened this handle for its own use, so it doesn't
+     count against a run loop's budget. */
+  unsigned internal : 1;
+
+  /* A handle primed on something else can also have a deadline, in
+     which case it belongs to a second binary heap ordered by
+     increasing time. */
+  struct react_deadline {
+    bheap_elem pos;
+    moment_type when;
+    int *expired;
+    unsigned set : 1;
+  } deadline;
+
+#if react_ALLOW_INOTIFY
+  /* This is the file watch that the handle was last primed on.  It is
+     kept after the handle is triggered, so that events occurring
+     before it is primed again are not lost, and released when the
+     handle is cancelled. */
+  struct react_watch *watch;
+#endif
 
   /* Many proactor-like events depend on a reactor-like event.  This
      entry lazily holds the latter. */
@@ -114,6 +164,17 @@ struct react_reg {
     size_t sz;
   } dyn;
 
+  /* A group handle owns a list of member handles, linked through
+     'member.next'.  A member knows its group and its position in it,
+     and remembers whether it fired while the group was not
+     primed. */
+  struct react_reg *members;
+  struct {
+    struct react_reg *owner, *next;
+    unsigned idx;
+    unsigned fired : 1;
+  } member;
+
   /* These describe the monitored event. */
   union {
     /* For idle events, we just belong to a list in the core. */
@@ -205,6 +266,54 @@ struct react_reg {
       react_iomode_t mode;
     } fd;
 #endif
+
+    /* The handle is waiting for some or all of its members. */
+    struct {
+      unsigned long mask, got, *fired;
+      int all;
+    } group;
+
+#if react_ALLOW_SIGNALFD
+    /* The handle is waiting for a specific signal. */
+    struct {
+      int signo;
+      siginfo_t *info;
+    } signal;
+#endif
+
+#if react_ALLOW_PIDFD
+    /* The handle is waiting for a child process to end, and its
+       subservient handle is watching the process's descriptor. */
+    struct {
+      int fd;
+      int *status, *en;
+    } child;
+#endif
+
+#if react_ALLOW_FILEIO
+    /* The handle is waiting for another thread to perform a file
+       operation. */
+    struct react_fileop *fileop;
+#endif
+
+#if react_ALLOW_INOTIFY
+    /* The handle belongs to a list of handles waiting for events on
+       the same watch. */
+    struct {
+      struct react_reg *next;
+      uint32_t mask, *events;
+    } filewatch;
+#endif
+
+#if react_ALLOW_FDSPLICE
+    /* The handle is waiting for a relay to finish. */
+    struct react_relaystr *relay;
+#endif
+
+#if react_ALLOW_ZEROCOPY
+    /* The handle is waiting for zero-copy sends to complete. */
+    struct react_zerocopystr *zerocopy;
+#endif
   } data;
 
   struct {
@@ -242,6 +351,15 @@ struct react_reg {
         unsigned flags;
         ssize_t *rc;
       } splice;
+#if react_ALLOW_SENDFILE
+      struct {
+        int fd_out, fd_in;
+        off_t *off;
+        size_t count;
+        int all;
+        ssize_t *rc;
+      } sendfile;
+#endif
 #endif
 
 #if react_ALLOW_SOCK
@@ -253,6 +371,7 @@ struct react_reg {
         react_ssize_t *rc;
         struct sockaddr *addr;
         react_socklen_t *addrlen;
+        struct react_dgraminfo *info;
       } recv;
       struct {
         react_sock_t fd;
@@ -260,6 +379,14 @@ struct react_reg {
         int flags;
         react_ssize_t *rc;
       } recvmsg;
+      struct {
+        react_sock_t fd;
+        struct react_bufpoolstr *pool;
+        size_t budget;
+        int flags;
+        struct react_buf **chain;
+        react_ssize_t *rc;
+      } recvchain;
       struct {
         react_sock_t fd;
         const void *buf;
@@ -268,6 +395,10 @@ struct react_reg {
         react_ssize_t *rc;
         const struct sockaddr *addr;
         react_socklen_t addrlen;
+        unsigned short segsize;
+#if react_ALLOW_ZEROCOPY
+        struct react_zerocopystr *zc;
+#endif
       } send;
       struct {
         react_sock_t fd;
@@ -275,6 +406,15 @@ struct react_reg {
         int flags;
         react_ssize_t *rc;
       } sendmsg;
+#if react_ALLOW_SOCKMMSG
+      struct {
+        react_sock_t fd;
+        struct mmsghdr *vec;
+        unsigned vlen;
+        int flags;
+        int *rc;
+      } mmsg;
+#endif
       struct {
         react_sock_t fd;
         react_sock_t *rc;
@@ -282,6 +422,16 @@ struct react_reg {
         react_socklen_t *addrlen;
         int flags;
       } accept;
+      struct {
+        react_sock_t fd;
+        int flags;
+        size_t max;
+        react_sock_t *socks;
+        struct sockaddr *addrs;
+        react_socklen_t addrsize;
+        react_socklen_t *addrlens;
+        size_t *got;
+      } acceptmany;
       struct {
         react_sock_t fd;
         const struct sockaddr *addr;
@@ -305,6 +455,63 @@ struct react_corestr {
   FILE *debug_str;
   unsigned debug_lvl;
 
+  /* These are always-on counters.  The system-buffer fields and the
+     backend name are only filled in when a snapshot is taken. */
+  struct react_stats stats;
+
+  /* This holds histograms of procedure times, and is null unless
+     timing has been enabled. */
+  struct react_profile *prof;
+
+  /* This is a ring of recent trace records, and is null unless
+     tracing has been enabled. */
+  struct react_trace *trace;
+
+  /* This records how late timed events are detected, and delays
+     from the core waking to find each handle queued to the start of
+     its procedure. */
+  struct react_hist timer_lag, wake_lag;
+
+  /* This is when we last finished waiting for events.  Handles queued
+     while we are not dispatching are stamped with the next such
+     time, so they are kept in a list until then. */
+  moment_type woke;
+  bool dispatching;
+  react_evlist fresh;
+
+  /* These handles completed optimistically while dispatching, and
+     will be queued at the start of the next yield. */
+  react_evlist deferred;
+
+  /* This is the longest we may spin before waiting, and the current
+     spin, which adapts to recent waits. */
+  struct {
+    unsigned long long max_ns, cur_ns;
+  } spin;
+
+  /* This describes a run loop in progress.  Another thread may ask
+     it to stop, and writes to a pipe to wake it.  The handle reading
+     the pipe is primed only while the loop runs, and is not counted
+     when deciding whether anything is left to wait for. */
+  struct {
+    atomic_bool stop;
+    bool active, timed, budgeted, waking;
+    moment_type until;
+    unsigned long left;
+#if react_ALLOW_FD
+    atomic_int wake_out;
+    int wake_in;
+    struct react_reg *ev;
+#endif
+  } run;
+
+  /* This hook is called when a timed procedure is slow. */
+  struct {
+    react_count_t threshold;
+    react_slowproc_t *func;
+    void *ctxt;
+  } slow;
+
   /* These are queues of triggered events. */
   struct {
     /* The number of queues in use */
@@ -331,6 +538,10 @@ struct react_corestr {
      time. */
   bheap timed;
 
+  /* These are handles with deadlines in a binary heap ordered by
+     increasing time. */
+  bheap deadlines;
+
 #if POLLCALL_WINDOWS
   /* This is a table indexed by a hash of a Windows socket number.
      Each entry records a WSAEVENT that will be associated with the
@@ -356,6 +567,31 @@ struct react_corestr {
   struct react_reg *sig_ev;
 #endif
 
+#if react_ALLOW_SIGNALFD
+  /* This is created when the first handle is primed on a specific
+     signal. */
+  struct react_sigfd *sigfd;
+#endif
+
+#if react_ALLOW_FILEIO
+  /* This pool of threads is created when the first file operation is
+     primed. */
+  struct react_fileio *fileio;
+  unsigned fileio_threads;
+#endif
+
+#if react_ALLOW_INOTIFY
+  /* This is created when the first handle is primed to watch a
+     file. */
+  struct react_inotify *inotify;
+#endif
+
+#if react_ALLOW_COREFD
+  /* This is created when the user asks for a descriptor representing
+     the core. */
+  struct react_corefd *corefd;
+#endif
+
 #if ARRAY_LIMIT > 0
   /* Keep a dynamic array of elements compatible with the poll call.
      For Windows, this is HANDLE.  For poll() and ppoll(), it is
@@ -523,13 +759,63 @@ struct react_corestr {
 };
 
 
+/* Add an interval to a histogram. */
+void react_histadd(struct react_hist *, unsigned long long ns);
+
+/* Invoke a handle's procedure, recording how long it takes in the
+   histogram for major priority p if timing is enabled, and tracing
+   its start and end if tracing is enabled. */
+void react_profproc(struct react_corestr *, struct react_reg *,
+                    react_prio_t p);
+
+/* Append a record to the core's trace ring, which must exist. */
+void react_tracerec(struct react_corestr *, unsigned type,
+                    struct react_reg *, long long arg);
+
+/* Release the resources of the run loop. */
+void react_closerun(struct react_corestr *);
+
+#if react_ALLOW_COREFD
+/* Make the core's descriptor readable if there is work to do now, or
+   when a timed event is due. */
+void react_armcorefd(struct react_corestr *);
+
+/* Keep the core's descriptor watching a file descriptor, whose
+   monitored events have changed. */
+void react_corefdwatch(struct react_corestr *, int fd,
+                       short before, short after);
+
+/* Re-arm the core's descriptor only if it exists. */
+#define react_corefdpoint(C) \
+  ((C)->corefd ? react_armcorefd(C) : (void) 0)
+
+/* Release the core's descriptor. */
+void react_closecorefd(struct react_corestr *);
+#else
+#define react_corefdpoint(C) ((void) 0)
+#endif
+
+/* Append a trace record only if tracing is enabled. */
+#define react_tracepoint(C, T, R, A) \
+  ((C)->trace ? react_tracerec((C), (T), (R), (A)) : (void) 0)
+
 /* Call and clear the defuse function of the handle, causing it to
    release all remaining resources with the reactor. */
 void react_defuse(struct react_reg *);
 
+/* Defusing a handle drops its deadline, so a proactor that re-primes
+   its handle internally saves the deadline first with
+   react_savedeadline(), and reinstates it after priming with
+   react_restoredeadline(). */
+void react_savedeadline(const struct react_reg *, struct react_deadline *);
+void react_restoredeadline(struct react_reg *, const struct react_deadline *);
+
 /* Ensure that the handle is properly queued.  Do nothing if it is. */
 void react_queue(struct react_reg *);
 
+/* Move handles deferred by react_wouldblock() into their queues. */
+void react_undefer(struct react_corestr *);
+
 /* Ensure that the handle is not queued.  Do nothing if it is not. */
 void react_dequeue(struct react_reg *);
 
@@ -544,6 +830,13 @@ void react_swapact(struct react_reg *r, action_proc_t *f, action_proc_t **fp);
 void react_cleanupwsausages(struct react_corestr *core);
 #endif
 
+/* Having optimistically attempted a proactor's operation, count the
+   outcome, and return non-zero if it failed with EAGAIN or
+   EWOULDBLOCK, so the handle must be primed as usual.  errno is
+   preserved.  If the operation completed while the core is
+   dispatching, the handle's queuing is deferred to the next yield. */
+int react_wouldblock(struct react_reg *, int failed);
+
 /* Open a handle to be subservient to an existing handle.  It will
    automatically be closed when the existing handle is closed.  Its
    default action will be to do nothing, as its purpose will not be to
@@ -553,6 +846,25 @@ struct react_reg *react_ensuresub(struct react_reg *r);
 /* Ensure that enough memory exists for additional uses. */
 void *react_ensuremem(struct react_reg *, size_t);
 
+#if react_ALLOW_SIGNALFD
+/* Release the descriptor that receives signals. */
+void react_closesigfd(struct react_corestr *);
+#endif
+
+#if react_ALLOW_FILEIO
+/* Stop the threads that perform file operations. */
+void react_closefileio(struct react_corestr *);
+#endif
+
+#if react_ALLOW_INOTIFY
+/* Release the descriptor that receives file events. */
+void react_closeinotify(struct react_corestr *);
+
+/* Let go of the handle's file watch, removing it if no other handle
+   holds it. */
+void react_releasewatch(struct react_reg *);
+#endif
+
 /* This is available internally on some systems even when not
    generally available to users. */
 int react_prime_fd(struct react_reg *, int, react_iomode_t);
@@ -48,6 +48,13 @@ static int compare_times(void *vc, const void *va, const void *vb)
                            &rb->data.systime.when);
 }
 
+static int compare_deadlines(void *vc, const void *va, const void *vb)
+{
+  const struct react_reg *ra = va;
+  const struct react_reg *rb = vb;
+  return react_systime_cmp(&ra->deadline.when, &rb->deadline.when);
+}
+
 struct react_corestr *react_opencoref(size_t prios, unsigned flags)
 {
 #if POLLCALL_RISCOS
@@ -115,10 +122,20 @@ struct react_corestr *react_opencoref(size_t prios, unsigned flags)
   core->unused_handle = GetCurrentThread();
 #endif
 
+  /* There is no run loop, and no pipe to wake it. */
+  atomic_init(&core->run.stop, false);
+#if react_ALLOW_FD
+  atomic_init(&core->run.wake_out, -1);
+  core->run.wake_in = -1;
+#endif
+
   /* Start with no timed events. */
   bheap_init(&core->timed, /* root */
              struct react_reg, data.systime.pos, /* structure */
              core, &compare_times); /* comparison */
+  bheap_init(&core->deadlines, /* root */
+             struct react_reg, deadline.pos, /* structure */
+             core, &compare_deadlines); /* comparison */
 
 #if KEEP_3FDSETS
   /* Start with no descriptor events. */
@@ -151,6 +168,20 @@ void react_closecore(struct react_corestr *core)
        r != NULL; r = dllist_next(in_core, r))
     react_cancel(r);
 
+#if react_ALLOW_SIGNALFD
+  react_closesigfd(core);
+#endif
+#if react_ALLOW_FILEIO
+  react_closefileio(core);
+#endif
+#if react_ALLOW_INOTIFY
+  react_closeinotify(core);
+#endif
+#if react_ALLOW_COREFD
+  react_closecorefd(core);
+#endif
+  react_closerun(core);
+
 #if KEEP_POLLREC
   free(core->pollrec.base);
 #endif
@@ -179,6 +210,9 @@ void react_closecore(struct react_corestr *core)
   _swix(ReactorHelp_ReleaseWord, _IN(0), (int) core->pollword);
 #endif
 
+  free(core->prof);
+  free(core->trace);
+
   /* Delete all queues. */
   for (size_t maj = 0; maj < core->queues.size; maj++)
     free(core->queues.base[maj].base);
@@ -195,6 +229,11 @@ void react_closecore(struct react_corestr *core)
   free(core);
 }
 
+void react_setspin(struct react_corestr *core, unsigned long long max_ns)
+{
+  core->spin.max_ns = core->spin.cur_ns = max_ns;
+}
+
 void react_debug(struct react_corestr *core, FILE *fp, unsigned lvl)
 {
   core->debug_str = fp;
@@ -0,0 +1,168 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+
+#include "common.h"
+#include "mytime.h"
+#include "react/core.h"
+
+#if react_ALLOW_COREFD
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+
+struct react_corefd {
+  /* The epoll descriptor watches the same descriptors as the core,
+     plus a timer descriptor that expires when the core next has work
+     to do regardless of them. */
+  int ep, tfd;
+
+  /* This is what the timer is armed for. */
+  bool armed, now;
+  moment_type when;
+};
+
+void react_armcorefd(struct react_corestr *core)
+{
+  struct react_corefd *cf = core->corefd;
+
+  /* Work out when the core will next have something to do. */
+  bool now = false;
+  const moment_type *first = NULL;
+  if (core->queues.top < core->queues.size ||
+      !dllist_isempty(&core->idlers) || !dllist_isempty(&core->deferred)) {
+    now = true;
+  } else {
+    struct react_reg *r = bheap_peek(&core->timed);
+    if (r)
+      first = &r->data.systime.when;
+    r = bheap_peek(&core->deadlines);
+    if (r && (!first || react_systime_cmp(&r->deadline.when, first) < 0))
+      first = &r->deadline.when;
+  }
+
+  /* Don't re-arm the timer for the same reason. */
+  if (now) {
+    if (cf->armed && cf->now) return;
+  } else if (first) {
+    if (cf->armed && !cf->now && react_systime_cmp(&cf->when, first) == 0)
+      return;
+  } else if (!cf->armed) {
+    return;
+  }
+
+  struct itimerspec spec = { { 0, 0 }, { 0, 0 } };
+  int flags = 0;
+  if (now) {
+    /* Expire straight away.  A zero value would disarm instead. */
+    spec.it_value.tv_nsec = 1;
+  } else if (first) {
+    unsigned long long ns = react_systime_ns(first);
+    spec.it_value.tv_sec = ns / 1000000000u;
+    spec.it_value.tv_nsec = ns % 1000000000u;
+    if (spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+      spec.it_value.tv_nsec = 1;
+    flags = TFD_TIMER_ABSTIME;
+  }
+  if (timerfd_settime(cf->tfd, flags, &spec, NULL) < 0) return;
+  cf->armed = now || first;
+  cf->now = now;
+  if (first)
+    cf->when = *first;
+}
+
+#if KEEP_POLLREC
+void react_corefdwatch(struct react_corestr *core, int fd,
+                       short before, short after)
+{
+  struct react_corefd *cf = core->corefd;
+  if (before == after) return;
+
+  /* poll() and epoll() share event bits on Linux. */
+  struct epoll_event ev = { .events = (unsigned short) after };
+  ev.data.fd = fd;
+  if (after == 0) {
+    /* The descriptor might already have been closed, and so
+       removed. */
+    epoll_ctl(cf->ep, EPOLL_CTL_DEL, fd, &ev);
+  } else if (before == 0 || epoll_ctl(cf->ep, EPOLL_CTL_MOD, fd, &ev) < 0) {
+    /* The descriptor might have been closed and reopened. */
+    epoll_ctl(cf->ep, EPOLL_CTL_ADD, fd, &ev);
+  }
+}
+#endif
+
+int react_getfd(struct react_corestr *core)
+{
+  if (core->corefd) return core->corefd->ep;
+
+#if KEEP_POLLREC
+  struct react_corefd *cf = malloc(sizeof *cf);
+  if (!cf) {
+    errno = react_ENOMEM;
+    return -1;
+  }
+  cf->armed = false;
+  cf->now = false;
+  cf->ep = epoll_create1(EPOLL_CLOEXEC);
+  if (cf->ep < 0) goto failed_ep;
+  cf->tfd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (cf->tfd < 0) goto failed_tfd;
+  struct epoll_event ev = { .events = EPOLLIN };
+  ev.data.fd = cf->tfd;
+  if (epoll_ctl(cf->ep, EPOLL_CTL_ADD, cf->tfd, &ev) < 0) goto failed_ctl;
+
+  /* Watch everything the core is already watching. */
+  core->corefd = cf;
+  for (unsigned fd = 0; fd < core->pollrec.size; fd++)
+    if (core->pollrec.base[fd] != 0)
+      react_corefdwatch(core, fd, 0, core->pollrec.base[fd]);
+  react_armcorefd(core);
+  return cf->ep;
+
+ failed_ctl:
+  close(cf->tfd);
+ failed_tfd:
+  close(cf->ep);
+ failed_ep:
+  free(cf);
+  return -1;
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+void react_closecorefd(struct react_corestr *core)
+{
+  struct react_corefd *cf = core->corefd;
+  if (!cf) return;
+  core->corefd = NULL;
+  close(cf->tfd);
+  close(cf->ep);
+  free(cf);
+}
+#endif
@@ -61,6 +61,17 @@ void react::Core_base::debug(FILE *fp, unsigned lvl)
   react_debug(core, fp, lvl);
 }
 
+void react::Core_base::stats(react_stats &st)
+{
+  react_getstats(core, &st);
+}
+
+void react::Core_base::profile(bool on)
+{
+  if (react_profile(core, on) < 0)
+    throw_errno();
+}
+
 Event react::Core_base::open(prio_t p, subprio_t sp, Handler *h)
 {
   shared_ptr<Event_base> r = open();
@@ -38,6 +38,7 @@ typedef int socklen_t;
 #else
 #include <sys/socket.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
@@ -80,6 +81,12 @@ typedef int SOCKET;
 
 using namespace std;
 
+// This is the ring-buffer size per direction.  It is small by
+// default, to exercise the reactor, but can be raised with -r, which
+// also turns off chatter.
+static size_t bufferSize = 256;
+static bool verbose = true;
+
 class Connection;
 
 class Stream {
@@ -88,8 +95,12 @@ class Stream {
   const struct sockaddr_in *remote;
 
   SOCKET source, dest;
-  char buf[256];
-  size_t start, end;
+
+  // This is a ring buffer, with counts of bytes read into and written
+  // from it.
+  char *buf;
+  size_t cap;
+  unsigned long long in, out;
 
   Connection &holder;
   void (Connection::*whenDone)();
@@ -210,18 +221,33 @@ int main(int argc, const char *const *argv)
 
   struct sockaddr_in local, remote;
 
-  if (argc < 3) {
-    cerr << "usage: " << argv[0] << " local-addr remote-addr" << endl;
+  // With -r, relay in bulk with large buffers, optionally of a given
+  // size.
+  int argi = 1;
+  if (argi < argc && !strncmp(argv[argi], "-r", 2)) {
+    bufferSize =
+      argv[argi][2] ? strtoul(argv[argi] + 2, NULL, 0) : 256 * 1024;
+    if (bufferSize == 0) {
+      cerr << argv[0] << ": bad relay size " << argv[argi] + 2 << endl;
+      return EXIT_FAILURE;
+    }
+    verbose = false;
+    argi++;
+  }
+
+  if (argc - argi < 2) {
+    cerr << "usage: " << argv[0] << " [-r[size]] local-addr remote-addr"
+         << endl;
     return EXIT_FAILURE;
   }
 
-  if (getaddr(local, argv[1]) < 0) {
-    cerr << argv[0] << ": couldn't resolve " << argv[1] << endl;
+  if (getaddr(local, argv[argi]) < 0) {
+    cerr << argv[0] << ": couldn't resolve " << argv[argi] << endl;
     return EXIT_FAILURE;
   }
 
-  if (getaddr(remote, argv[2]) < 0) {
-    cerr << argv[0] << ": couldn't resolve " << argv[2] << endl;
+  if (getaddr(remote, argv[argi + 1]) < 0) {
+    cerr << argv[0] << ": couldn't resolve " << argv[argi + 1] << endl;
     return EXIT_FAILURE;
   }
 
@@ -249,8 +275,13 @@ void Stream::checkTermination()
   if (complete)
     return;
 
-  if (!more && start == end) {
+  if (!more && in == out) {
     complete = true;
+#ifdef __WIN32__
+    shutdown(dest, SD_SEND);
+#else
+    shutdown(dest, SHUT_WR);
+#endif
     (holder.*whenDone)();
   }
 }
@@ -258,8 +289,9 @@ void Stream::checkTermination()
 void Stream::readyToWrite()
 {
   if (remote) {
-    cout << "Completing connection to " << inet_ntoa(remote->sin_addr)
-         << ":" << ntohs(remote->sin_port) << endl;
+    if (verbose)
+      cout << "Completing connection to " << inet_ntoa(remote->sin_addr)
+           << ":" << ntohs(remote->sin_port) << endl;
 
     if (connect(dest, (struct sockaddr *) remote, sizeof *remote) ==
         SOCKET_ERROR) {
@@ -273,17 +305,25 @@ void Stream::readyToWrite()
     return;
   }
 
-  int done = send(dest, buf + start, end - start, 0);
+  // Send from the stored data, which might wrap around.
+  size_t fill = in - out;
+  size_t pos = out % cap;
+  size_t first = cap - pos;
+  if (first > fill) first = fill;
+#ifdef __WIN32__
+  int done = send(dest, buf + pos, first, 0);
+#else
+  struct iovec v[2];
+  v[0].iov_base = buf + pos;
+  v[0].iov_len = first;
+  v[1].iov_base = buf;
+  v[1].iov_len = fill - first;
+  ssize_t done = writev(dest, v, fill > first ? 2 : 1);
+#endif
   if (done < 0) {
     // erm
   } else {
-    start += done;
-
-    if (end - start < 16) {
-      memmove(buf, buf + start, end - start);
-      end -= start;
-      start = 0;
-    }
+    out += done;
 
     ensureRead();
     ensureWrite();
@@ -294,14 +334,28 @@ void Stream::readyToWrite()
 
 void Stream::readyToRead()
 {
-  int got = recv(source, buf + end, sizeof buf - end, 0);
+  // Receive into the free space, which might wrap around.
+  size_t space = cap - (in - out);
+  size_t pos = in % cap;
+  size_t first = cap - pos;
+  if (first > space) first = space;
+#ifdef __WIN32__
+  int got = recv(source, buf + pos, first, 0);
+#else
+  struct iovec v[2];
+  v[0].iov_base = buf + pos;
+  v[0].iov_len = first;
+  v[1].iov_base = buf;
+  v[1].iov_len = space - first;
+  ssize_t got = readv(source, v, space > first ? 2 : 1);
+#endif
   if (got == 0) {
     more = false;
     checkTermination();
   } else if (got < 0) {
     // erm
   } else {
-    end += got;
+    in += got;
 
     ensureRead();
     ensureWrite();
@@ -310,7 +364,7 @@ void Stream::readyToRead()
 
 void Stream::ensureRead()
 {
-  if (end == sizeof buf) return;
+  if (!more || in - out == cap) return;
   if (readEvent->primed()) return;
   react::SocketCondition cond(source, react_MIN);
   readEvent->prime(cond);
@@ -318,7 +372,7 @@ void Stream::ensureRead()
 
 void Stream::ensureWrite()
 {
-  if (start == end && !remote) return;
+  if (in == out && !remote) return;
   if (writeEvent->primed()) return;
   react::SocketCondition cond(dest, react_MOUT);
   writeEvent->prime(cond);
@@ -329,7 +383,8 @@ Stream::Stream(react::Core core, react::prio_t prio,
                Connection &holder, void (Connection::*whenDone)(),
                const struct sockaddr_in *remote)
   : more(true), complete(false),
-    remote(remote), source(from), dest(to), start(0), end(0),
+    remote(remote), source(from), dest(to),
+    buf(new char[bufferSize]), cap(bufferSize), in(0), out(0),
     holder(holder), whenDone(whenDone),
     writeDelegate(*this, &Stream::readyToWrite),
     readDelegate(*this, &Stream::readyToRead),
@@ -338,6 +393,7 @@ Stream::Stream(react::Core core, react::prio_t prio,
 
 Stream::~Stream()
 {
+  delete[] buf;
 }
 
 
@@ -350,14 +406,16 @@ void Connection::checkEnd()
 
 void Connection::upstreamDone()
 {
-  cout << "No more upstream" << endl;
+  if (verbose)
+    cout << "No more upstream" << endl;
   moreUpstream = false;
   checkEnd();
 }
 
 void Connection::downstreamDone()
 {
-  cout << "No more downstream" << endl;
+  if (verbose)
+    cout << "No more downstream" << endl;
   moreDownstream = false;
   checkEnd();
 }
@@ -386,8 +444,9 @@ void Connection::go()
   if (ioctlsocket(server, FIONBIO, &flag) == SOCKET_ERROR)
     throw_errno();
 
-  cout << "Initiating connection to " << inet_ntoa(remote.sin_addr)
-       << ":" << ntohs(remote.sin_port) << endl;
+  if (verbose)
+    cout << "Initiating connection to " << inet_ntoa(remote.sin_addr)
+         << ":" << ntohs(remote.sin_port) << endl;
 
   if (connect(server, (struct sockaddr *) &remote, sizeof remote) ==
       SOCKET_ERROR) {
@@ -400,7 +459,8 @@ void Connection::go()
 #endif
   }
 
-  cout << "Starting streams..." << endl;
+  if (verbose)
+    cout << "Starting streams..." << endl;
 
   upstream = new Stream(core, prio, client, server,
                         *this, &Connection::upstreamDone, &remote);
@@ -434,8 +494,9 @@ void Proxy::acceptReady()
   if (client == SOCKET_ERROR)
     throw_errno();
 
-  cout << "Accepted " << inet_ntoa(addr.sin_addr)
-       << ":" << ntohs(addr.sin_port) << endl;
+  if (verbose)
+    cout << "Accepted " << inet_ntoa(addr.sin_addr)
+         << ":" << ntohs(addr.sin_port) << endl;
   Connection *conn = new Connection(core, CONN_PRIO, 
                                     client, remote,
                                     *this, &Proxy::finished);
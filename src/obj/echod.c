@@ -27,6 +27,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 
 #ifdef __WIN32__
 #include <winsock2.h>
@@ -36,6 +37,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <fcntl.h>
 #define closesocket(S) close(S)
 #endif
 
@@ -45,15 +47,27 @@
 #include "react/event.h"
 #include "react/socket.h"
 #include "react/file.h"
+#include "react/time.h"
 
 struct srv;
 
+/* This is how many connections are accepted at once in benchmark
+   mode. */
+#define ACCEPT_BATCH 64
+
 struct conn {
   struct srv *srv;
   dllist_elem(struct conn) others;
   react_sock_t sock;
   react_t datain;
   struct sockaddr_in addr;
+
+  /* These are only used in benchmark mode, where the connection
+     alternates between receiving into buf and sending it back. */
+  char *buf;
+  size_t len, done;
+  react_ssize_t rc;
+  int en;
 };
 
 struct srv {
@@ -62,6 +76,26 @@ struct srv {
   react_core_t core;
   react_t acceptable;
   bool more;
+
+  /* In benchmark mode, nothing is printed, sockets are non-blocking,
+     and each connection has a buffer of this size.  Otherwise, it is
+     zero. */
+  size_t bench;
+
+  /* In benchmark mode, this is true if each connection is to attempt
+     reception and transmission before waiting. */
+  bool optimistic;
+
+  /* In benchmark mode, connections are accepted in batches. */
+  react_sock_t accepted[ACCEPT_BATCH];
+  struct sockaddr_in addrs[ACCEPT_BATCH];
+  react_socklen_t addrlens[ACCEPT_BATCH];
+  size_t naccepted;
+  int en;
+
+  /* This is set while accepting is suspended after a persistent
+     error, such as running out of descriptors. */
+  bool backoff;
 };
 
 static void display_error(const char *msg)
@@ -77,6 +111,67 @@ static int conn_prime(struct conn *c)
   return react_prime_sockin(c->datain, c->sock);
 }
 
+static void close_conn(struct conn *c)
+{
+  closesocket(c->sock);
+  react_close(c->datain);
+  dllist_unlink(&c->srv->conns, others, c);
+  free(c->buf);
+  free(c);
+}
+
+static void on_bench_recv(void *ctxt);
+
+static void on_bench_send(void *ctxt)
+{
+  struct conn *c = ctxt;
+  if (c->rc < 0) {
+    if (c->en == EAGAIN || c->en == EWOULDBLOCK || c->en == EINTR) {
+      c->rc = 0;
+    } else {
+      close_conn(c);
+      return;
+    }
+  }
+  c->done += c->rc;
+  if (c->done < c->len) {
+    /* Send the rest. */
+    react_direct(c->datain, &on_bench_send, c);
+    int rc = react_prime_send(c->datain, c->sock, c->buf + c->done,
+                              c->len - c->done, 0, &c->rc, &c->en);
+    assert(rc == 0);
+    return;
+  }
+
+  /* Everything has been echoed, so receive more. */
+  react_direct(c->datain, &on_bench_recv, c);
+  int rc = react_prime_recv(c->datain, c->sock, c->buf, c->srv->bench, 0,
+                            &c->rc, &c->en);
+  assert(rc == 0);
+}
+
+static void on_bench_recv(void *ctxt)
+{
+  struct conn *c = ctxt;
+  if (c->rc < 0 &&
+      (c->en == EAGAIN || c->en == EWOULDBLOCK || c->en == EINTR)) {
+    int rc = react_prime_recv(c->datain, c->sock, c->buf, c->srv->bench, 0,
+                              &c->rc, &c->en);
+    assert(rc == 0);
+    return;
+  }
+  if (c->rc <= 0) {
+    close_conn(c);
+    return;
+  }
+
+  /* Send back what we got. */
+  c->len = c->rc;
+  c->done = 0;
+  c->rc = 0;
+  on_bench_send(c);
+}
+
 static void on_read(void *ctxt)
 {
   struct conn *c = ctxt;
@@ -88,9 +183,7 @@ static void on_read(void *ctxt)
     printf("%s:%d TERMINATED\n",
            inet_ntoa(c->addr.sin_addr),
            ntohs(c->addr.sin_port));
-    closesocket(c->sock);
-    react_close(c->datain);
-    dllist_unlink(&c->srv->conns, others, c);
+    close_conn(c);
   } else {
     buf[rc] = '\0';
     printf("%s:%d: %s\n",
@@ -114,11 +207,33 @@ static struct conn *open_conn(struct srv *srv, react_sock_t sock,
   c->srv = srv;
   c->sock = sock;
   c->addr = *addr;
+  c->buf = NULL;
   c->datain = react_open(srv->core);
   if (c->datain == react_ERROR) {
     perror("react_open(conn)");
     free(c);
     return NULL;
+  } else if (srv->bench) {
+    c->buf = malloc(srv->bench);
+    if (c->buf == NULL) {
+      perror("malloc");
+      react_close(c->datain);
+      free(c);
+      return NULL;
+    }
+#ifdef __WIN32__
+    u_long on = 1;
+    ioctlsocket(sock, FIONBIO, &on);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+#endif
+    dllist_append(&srv->conns, others, c);
+    react_optimistic(c->datain, srv->optimistic);
+    react_direct(c->datain, &on_bench_recv, c);
+    c->rc = -1;
+    c->en = EAGAIN;
+    on_bench_recv(c);
+    return c;
   } else {
     react_direct(c->datain, &on_read, c);
     int rc = conn_prime(c);
@@ -130,40 +245,104 @@ static struct conn *open_conn(struct srv *srv, react_sock_t sock,
 
 static int srv_prime(struct srv *srv)
 {
+  if (srv->bench)
+    return react_prime_acceptmany(srv->acceptable, srv->sock, 0,
+                                  ACCEPT_BATCH, srv->accepted,
+                                  (struct sockaddr *) srv->addrs,
+                                  sizeof srv->addrs[0], srv->addrlens,
+                                  &srv->naccepted, &srv->en);
   return react_prime_sockin(srv->acceptable, srv->sock);
 }
 
+static bool transient(int en)
+{
+  return en == EAGAIN || en == EWOULDBLOCK || en == EINTR ||
+    en == ECONNABORTED;
+}
+
+/* Retrying a persistent error, such as running out of descriptors,
+   straight away would spin, so pause for a while.  time() can lag
+   behind the reactor's clock, so aim for the second after next. */
+static void srv_pause(struct srv *srv)
+{
+  time_t when = time(NULL) + 2;
+  srv->backoff = true;
+  int rc = react_prime_stdtime(srv->acceptable, &when);
+  assert(rc == 0);
+}
+
 static void on_accept(void *ctxt)
 {
   struct srv *srv = ctxt;
+  if (srv->backoff) {
+    srv->backoff = false;
+    int rc = srv_prime(srv);
+    assert(rc == 0);
+    return;
+  }
+
+  if (srv->bench) {
+    if (srv->naccepted == 0) {
+      fprintf(stderr, "accept: %s\n", strerror(srv->en));
+      if (!transient(srv->en)) {
+        srv_pause(srv);
+        return;
+      }
+    }
+    for (size_t i = 0; i < srv->naccepted; i++)
+      if (open_conn(srv, srv->accepted[i], &srv->addrs[i]) == NULL)
+        closesocket(srv->accepted[i]);
+    int rc = srv_prime(srv);
+    assert(rc == 0);
+    return;
+  }
+
   struct sockaddr_in addr;
   react_socklen_t addrlen = sizeof addr;
   react_sock_t sock = accept(srv->sock, (struct sockaddr *) &addr, &addrlen);
   if (sock == react_INVALID_SOCKET) {
     display_error("accept");
-  } else {
-    struct conn *conn = open_conn(srv, sock, &addr);
-    assert(conn != NULL);
+    if (!transient(errno)) {
+      srv_pause(srv);
+      return;
+    }
+  } else if (open_conn(srv, sock, &addr) == NULL) {
+    closesocket(sock);
   }
 
   int rc = srv_prime(srv);
   assert(rc == 0);
 }
 
-static int srv_init(struct srv *srv, int sock, react_core_t core)
+static int srv_init(struct srv *srv, int sock, react_core_t core,
+                    size_t bench, bool optimistic)
 {
-  if (listen(sock, 5) < 0)
+  if (listen(sock, bench ? SOMAXCONN : 5) < 0)
     return -1;
 
   srv->acceptable = react_open(core);
   if (srv->acceptable == react_ERROR)
     return -1;
 
+  if (bench) {
+    /* Batches of connections can only be accepted without
+       blocking. */
+#ifdef __WIN32__
+    u_long on = 1;
+    ioctlsocket(sock, FIONBIO, &on);
+#else
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+#endif
+  }
+
   react_direct(srv->acceptable, &on_accept, srv);
   dllist_init(&srv->conns);
   srv->sock = sock;
   srv->core = core;
   srv->more = true;
+  srv->bench = bench;
+  srv->optimistic = optimistic;
+  srv->backoff = false;
 
   if (srv_prime(srv) < 0) {
     react_close(srv->acceptable);
@@ -174,7 +353,29 @@ static int srv_init(struct srv *srv, int sock, react_core_t core)
 
 int main(int argc, const char *const *argv)
 {
-  printf("Welcome!\n");
+  /* With -b, run in benchmark mode, optionally with a buffer size.
+     With -o, make optimistic attempts in benchmark mode.  With -p,
+     use a different port. */
+  size_t bench = 0;
+  bool optimistic = false;
+  int port = 8000;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-b")) {
+      bench = 64 * 1024;
+    } else if (!strncmp(argv[i], "-b", 2)) {
+      bench = strtoul(argv[i] + 2, NULL, 0);
+    } else if (!strcmp(argv[i], "-o")) {
+      optimistic = true;
+    } else if (!strcmp(argv[i], "-p") && i + 1 < argc) {
+      port = atoi(argv[++i]);
+    } else {
+      fprintf(stderr, "usage: %s [-b[bufsize]] [-o] [-p port]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!bench)
+    printf("Welcome!\n");
 
 #ifdef __WIN32__
   WSADATA wsaData;
@@ -196,7 +397,7 @@ int main(int argc, const char *const *argv)
   memset(&addr, 0, sizeof addr);
   addr.sin_family = AF_INET;
   addr.sin_addr.s_addr = htonl(INADDR_ANY);
-  addr.sin_port = htons(8000);
+  addr.sin_port = htons(port);
   if (bind(sock, (struct sockaddr *) &addr, sizeof addr) == react_SOCKET_ERROR) {
     display_error("bind");
     return EXIT_FAILURE;
@@ -207,12 +408,13 @@ int main(int argc, const char *const *argv)
     return EXIT_FAILURE;
   }
   struct srv srv;
-  if (srv_init(&srv, sock, core) < 0) {
+  if (srv_init(&srv, sock, core, bench, optimistic) < 0) {
     perror("srv_init");
     return EXIT_FAILURE;
   }
 
-  printf("Polling...!\n");
+  if (!bench)
+    printf("Polling...!\n");
 
   while (srv.more) {
     int rc = react_yield(core);
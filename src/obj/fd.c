@@ -30,6 +30,9 @@
 
 #if react_ALLOW_FD
 #include <sys/uio.h>
+#if react_ALLOW_SENDFILE
+#include <sys/sendfile.h>
+#endif
 
 int react_prime_fdin(struct react_reg *r, int fd)
 {
@@ -56,107 +59,148 @@ static inline void setrsz(react_ssize_t *p, react_ssize_t v)
   if (p) *p = v;
 }
 
-static void on_readv(struct react_reg *r)
+static void complete(struct react_reg *r,
+                     react_ssize_t rc, react_ssize_t *rcp)
 {
-  (*r->proact.act)(r);
-  react_ssize_t rc = readv(r->proact.sub.readwritev.fd,
-                           r->proact.sub.readwritev.v0,
-                           r->proact.sub.readwritev.nv);
   if (rc < 0)
     setint(r->proact.en, errno);
-  setrsz(r->proact.sub.readwritev.rc, rc);
+  setrsz(rcp, rc);
   react_trigger(r);
 }
 
+static react_ssize_t do_readv(struct react_reg *r)
+{
+  return readv(r->proact.sub.readwritev.fd,
+               r->proact.sub.readwritev.v0,
+               r->proact.sub.readwritev.nv);
+}
+
+static void on_readv(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete(r, do_readv(r), r->proact.sub.readwritev.rc);
+}
+
 int react_prime_readv(struct react_reg *r, int fd,
                       const struct iovec *v0, int nv, ssize_t *rc, int *en)
 {
-  int orc = react_prime_fdin(r, fd);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_readv, &r->proact.act);
   r->proact.sub.readwritev.rc = rc;
   r->proact.sub.readwritev.fd = fd;
   r->proact.sub.readwritev.v0 = v0;
   r->proact.sub.readwritev.nv = nv;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_readv(r);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_fdin(r, fd);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_readv, &r->proact.act);
   return 0;
 }
 
+static react_ssize_t do_writev(struct react_reg *r)
+{
+  return writev(r->proact.sub.readwritev.fd,
+                r->proact.sub.readwritev.v0,
+                r->proact.sub.readwritev.nv);
+}
+
 static void on_writev(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = writev(r->proact.sub.readwritev.fd,
-                            r->proact.sub.readwritev.v0,
-                            r->proact.sub.readwritev.nv);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.readwritev.rc, rc);
-  react_trigger(r);
+  complete(r, do_writev(r), r->proact.sub.readwritev.rc);
 }
 
 int react_prime_writev(struct react_reg *r, int fd,
                        const struct iovec *v0, int nv, ssize_t *rc, int *en)
 {
-  int orc = react_prime_fdout(r, fd);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_writev, &r->proact.act);
   r->proact.sub.readwritev.rc = rc;
   r->proact.sub.readwritev.fd = fd;
   r->proact.sub.readwritev.v0 = v0;
   r->proact.sub.readwritev.nv = nv;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_writev(r);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_fdout(r, fd);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_writev, &r->proact.act);
   return 0;
 }
 
+static react_ssize_t do_read(struct react_reg *r)
+{
+  return read(r->proact.sub.read.fd,
+              r->proact.sub.read.buf,
+              r->proact.sub.read.len);
+}
+
 static void on_read(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = read(r->proact.sub.read.fd,
-                          r->proact.sub.read.buf,
-                          r->proact.sub.read.len);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.read.rc, rc);
-  react_trigger(r);
+  complete(r, do_read(r), r->proact.sub.read.rc);
 }
 
 int react_prime_read(struct react_reg *r, int fd, void *buf, size_t len,
                      ssize_t *rc, int *en)
 {
-  int orc = react_prime_fdin(r, fd);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_read, &r->proact.act);
   r->proact.sub.read.rc = rc;
   r->proact.sub.read.fd = fd;
   r->proact.sub.read.buf = buf;
   r->proact.sub.read.len = len;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_read(r);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_fdin(r, fd);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_read, &r->proact.act);
   return 0;
 }
 
+static react_ssize_t do_write(struct react_reg *r)
+{
+  return write(r->proact.sub.write.fd,
+               r->proact.sub.write.buf,
+               r->proact.sub.write.len);
+}
+
 static void on_write(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = write(r->proact.sub.write.fd,
-                           r->proact.sub.write.buf,
-                           r->proact.sub.write.len);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.write.rc, rc);
-  react_trigger(r);
+  complete(r, do_write(r), r->proact.sub.write.rc);
 }
 
 int react_prime_write(struct react_reg *r, int fd, const void *buf, size_t len,
                       ssize_t *rc, int *en)
 {
-  int orc = react_prime_fdin(r, fd);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_write, &r->proact.act);
   r->proact.sub.write.rc = rc;
   r->proact.sub.write.fd = fd;
   r->proact.sub.write.buf = buf;
   r->proact.sub.write.len = len;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_write(r);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_fdout(r, fd);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_write, &r->proact.act);
   return 0;
 }
 
@@ -212,9 +256,12 @@ static void on_splicedualready(struct react_reg *r)
   (*r->proact.act)(r);
 
 #if react_ALLOW_POLLS
-  if (r->proact.sub.splice.polls[0].revents & POLLHUP) {
+  if ((r->proact.sub.splice.polls[0].revents & (POLLHUP | POLLIN)) ==
+      POLLHUP) {
     /* The input has ended.  We don't even need to call splice(), just
-       report a zero-length transfer. */
+       report a zero-length transfer.  A socket can be hung up with
+       data still to be read, so only do this if it is not also
+       readable. */
     setrsz(r->proact.sub.splice.rc, 0);
     react_trigger(r);
     return;
@@ -356,4 +403,75 @@ int react_prime_splice_dual(struct react_reg *r,
 
 #endif // splice supported
 
+#if react_ALLOW_SENDFILE
+/* Send from the file, and if asked, keep going until the count is
+   exhausted, the file ends, or the socket is full. */
+static ssize_t do_sendfile(struct react_reg *r)
+{
+  size_t left = r->proact.sub.sendfile.count;
+  ssize_t total = 0;
+  while (left > 0) {
+    ssize_t rc = sendfile(r->proact.sub.sendfile.fd_out,
+                          r->proact.sub.sendfile.fd_in,
+                          r->proact.sub.sendfile.off, left);
+    if (rc < 0) {
+      if (errno == EINTR) continue;
+
+      /* Report what we sent, and let the error recur next time. */
+      if (total > 0) break;
+      return rc;
+    }
+    if (rc == 0) break;
+    total += rc;
+    left -= rc;
+    if (!r->proact.sub.sendfile.all) break;
+  }
+  return total;
+}
+
+static void on_sendfile(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete(r, do_sendfile(r), r->proact.sub.sendfile.rc);
+}
+
+static int prime_sendfile(struct react_reg *r, int sock, int fd,
+                          off_t *offset, size_t count, int all,
+                          ssize_t *rc, int *en)
+{
+  r->proact.sub.sendfile.fd_out = sock;
+  r->proact.sub.sendfile.fd_in = fd;
+  r->proact.sub.sendfile.off = offset;
+  r->proact.sub.sendfile.count = count;
+  r->proact.sub.sendfile.all = all;
+  r->proact.sub.sendfile.rc = rc;
+  r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_sendfile(r);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_fdout(r, sock);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_sendfile, &r->proact.act);
+  return 0;
+}
+
+int react_prime_sendfile(struct react_reg *r, int sock, int fd,
+                         off_t *offset, size_t count,
+                         ssize_t *rc, int *en)
+{
+  return prime_sendfile(r, sock, fd, offset, count, 0, rc, en);
+}
+
+int react_prime_sendfile_all(struct react_reg *r, int sock, int fd,
+                             off_t *offset, size_t count,
+                             ssize_t *rc, int *en)
+{
+  return prime_sendfile(r, sock, fd, offset, count, 1, rc, en);
+}
+#endif
+
 #endif
@@ -0,0 +1,353 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/fd.h"
+#include "react/file.h"
+
+#if react_ALLOW_FILEIO
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+
+/* This is the number of threads used if not set. */
+#define DEFAULT_THREADS 4
+
+enum op { OP_READ, OP_WRITE, OP_PREAD, OP_PWRITE };
+
+enum state { ST_QUEUED, ST_RUNNING, ST_DONE };
+
+struct react_fileop {
+  dllist_elem(struct react_fileop) others;
+  struct react_reg *r;
+
+  enum op op;
+  enum state state;
+  int fd;
+  void *buf;
+  size_t len;
+  off_t off;
+
+  /* These are the results, and the caller's places for them. */
+  ssize_t got;
+  int err;
+  ssize_t *rc;
+  int *en;
+};
+
+struct react_fileio {
+  pthread_mutex_t lock;
+  pthread_cond_t work, done;
+  unsigned stopping : 1;
+
+  /* Operations wait in one list to be performed, and in another to
+     be reported. */
+  dllist_hdr(struct react_fileop) queued, finished;
+
+  /* A byte is written to the pipe when the finished list becomes
+     non-empty.  The handle watches the other end while operations
+     are outstanding. */
+  int wake[2];
+  struct react_reg *ev;
+  size_t outstanding;
+
+  size_t nthreads;
+  pthread_t threads[];
+};
+
+static void perform(struct react_fileop *op)
+{
+  switch (op->op) {
+  case OP_READ:
+    op->got = read(op->fd, op->buf, op->len);
+    break;
+  case OP_WRITE:
+    op->got = write(op->fd, op->buf, op->len);
+    break;
+  case OP_PREAD:
+    op->got = pread(op->fd, op->buf, op->len, op->off);
+    break;
+  case OP_PWRITE:
+    op->got = pwrite(op->fd, op->buf, op->len, op->off);
+    break;
+  }
+  op->err = op->got < 0 ? errno : 0;
+}
+
+static void *run_worker(void *ctxt)
+{
+  struct react_fileio *io = ctxt;
+  pthread_mutex_lock(&io->lock);
+  for ( ; ; ) {
+    while (!io->stopping && dllist_isempty(&io->queued))
+      pthread_cond_wait(&io->work, &io->lock);
+    if (io->stopping) break;
+
+    struct react_fileop *op = dllist_first(&io->queued);
+    dllist_unlink(&io->queued, others, op);
+    op->state = ST_RUNNING;
+    pthread_mutex_unlock(&io->lock);
+
+    perform(op);
+
+    pthread_mutex_lock(&io->lock);
+    op->state = ST_DONE;
+    int first = dllist_isempty(&io->finished);
+    dllist_append(&io->finished, others, op);
+    if (first) {
+      static const unsigned char one = 1;
+      (void) write(io->wake[1], &one, 1);
+    }
+    pthread_cond_broadcast(&io->done);
+  }
+  pthread_mutex_unlock(&io->lock);
+  return NULL;
+}
+
+static void on_finished(void *ctxt)
+{
+  struct react_fileio *io = ctxt;
+
+  /* Clear the wake-up signal before collecting, so that nothing
+     finishing later is missed. */
+  unsigned char buf[64];
+  while (read(io->wake[0], buf, sizeof buf) > 0)
+    ;
+
+  pthread_mutex_lock(&io->lock);
+  struct react_fileop *list = dllist_first(&io->finished);
+  dllist_init(&io->finished);
+  pthread_mutex_unlock(&io->lock);
+
+  while (list) {
+    struct react_fileop *op = list;
+    list = dllist_next(others, op);
+    struct react_reg *r = op->r;
+    *op->rc = op->got;
+    *op->en = op->err;
+    r->data.fileop = NULL;
+    free(op);
+    io->outstanding--;
+    react_trigger(r);
+  }
+
+  if (io->outstanding > 0)
+    react_prime_fdin(io->ev, io->wake[0]);
+}
+
+static struct react_fileio *ensure_fileio(struct react_corestr *core)
+{
+  if (core->fileio) return core->fileio;
+
+  size_t n = core->fileio_threads ? core->fileio_threads : DEFAULT_THREADS;
+  struct react_fileio *io = malloc(sizeof *io + n * sizeof io->threads[0]);
+  if (!io) {
+    errno = react_ENOMEM;
+    return NULL;
+  }
+  io->stopping = 0;
+  io->outstanding = 0;
+  io->nthreads = 0;
+  dllist_init(&io->queued);
+  dllist_init(&io->finished);
+
+  if (pipe(io->wake) < 0) goto failed_pipe;
+  fcntl(io->wake[0], F_SETFL, fcntl(io->wake[0], F_GETFL) | O_NONBLOCK);
+  fcntl(io->wake[1], F_SETFL, fcntl(io->wake[1], F_GETFL) | O_NONBLOCK);
+  fcntl(io->wake[0], F_SETFD, FD_CLOEXEC);
+  fcntl(io->wake[1], F_SETFD, FD_CLOEXEC);
+
+  io->ev = react_open(core);
+  if (io->ev == react_ERROR) goto failed_ev;
+  react_direct(io->ev, &on_finished, io);
+  io->ev->internal = 1;
+
+  pthread_mutex_init(&io->lock, NULL);
+  pthread_cond_init(&io->work, NULL);
+  pthread_cond_init(&io->done, NULL);
+
+  /* Workers inherit the creating thread's signal mask, so block
+     everything while creating them.  Signals are then left to the
+     application's own threads. */
+  sigset_t all, prev;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &prev);
+  int rc = 0;
+  for ( ; io->nthreads < n; io->nthreads++) {
+    rc = pthread_create(&io->threads[io->nthreads], NULL, &run_worker, io);
+    if (rc != 0) break;
+  }
+  pthread_sigmask(SIG_SETMASK, &prev, NULL);
+  if (io->nthreads == 0) {
+    errno = rc;
+    goto failed_threads;
+  }
+
+  core->fileio = io;
+  return io;
+
+ failed_threads:
+  pthread_cond_destroy(&io->done);
+  pthread_cond_destroy(&io->work);
+  pthread_mutex_destroy(&io->lock);
+  react_close(io->ev);
+ failed_ev:
+  close(io->wake[0]);
+  close(io->wake[1]);
+ failed_pipe:
+  free(io);
+  return NULL;
+}
+
+void react_closefileio(struct react_corestr *core)
+{
+  struct react_fileio *io = core->fileio;
+  if (!io) return;
+  core->fileio = NULL;
+
+  pthread_mutex_lock(&io->lock);
+  io->stopping = 1;
+  pthread_cond_broadcast(&io->work);
+  pthread_mutex_unlock(&io->lock);
+  for (size_t i = 0; i < io->nthreads; i++)
+    pthread_join(io->threads[i], NULL);
+
+  pthread_cond_destroy(&io->done);
+  pthread_cond_destroy(&io->work);
+  pthread_mutex_destroy(&io->lock);
+  react_close(io->ev);
+  close(io->wake[0]);
+  close(io->wake[1]);
+  free(io);
+}
+
+int react_setfilethreads(struct react_corestr *core, unsigned n)
+{
+  if (core->fileio) {
+    errno = react_EBADSTATE;
+    return -1;
+  }
+  if (n == 0) {
+    errno = react_EINVAL;
+    return -1;
+  }
+  core->fileio_threads = n;
+  return 0;
+}
+
+static void defuse_fileop(struct react_reg *r)
+{
+  struct react_fileop *op = r->data.fileop;
+  if (!op) return;
+  struct react_fileio *io = r->core->fileio;
+
+  /* Withdraw the operation, waiting for it if it is under way. */
+  pthread_mutex_lock(&io->lock);
+  if (op->state == ST_QUEUED) {
+    dllist_unlink(&io->queued, others, op);
+  } else {
+    while (op->state == ST_RUNNING)
+      pthread_cond_wait(&io->done, &io->lock);
+    dllist_unlink(&io->finished, others, op);
+  }
+  pthread_mutex_unlock(&io->lock);
+
+  r->data.fileop = NULL;
+  free(op);
+  if (--io->outstanding == 0)
+    react_cancel(io->ev);
+}
+
+static int submit(struct react_reg *r, enum op code, int fd,
+                  void *buf, size_t len, off_t off,
+                  ssize_t *rc, int *en)
+{
+  react_cancel(r);
+
+  struct react_fileio *io = ensure_fileio(r->core);
+  if (!io) return -1;
+
+  struct react_fileop *op = malloc(sizeof *op);
+  if (!op) {
+    errno = react_ENOMEM;
+    return -1;
+  }
+  op->r = r;
+  op->op = code;
+  op->state = ST_QUEUED;
+  op->fd = fd;
+  op->buf = buf;
+  op->len = len;
+  op->off = off;
+  op->rc = rc;
+  op->en = en;
+
+  if (io->outstanding == 0 && react_prime_fdin(io->ev, io->wake[0]) < 0) {
+    free(op);
+    return -1;
+  }
+  io->outstanding++;
+
+  r->data.fileop = op;
+  r->act = &react_trigger;
+  r->defuse = &defuse_fileop;
+
+  pthread_mutex_lock(&io->lock);
+  dllist_append(&io->queued, others, op);
+  pthread_cond_signal(&io->work);
+  pthread_mutex_unlock(&io->lock);
+  return 0;
+}
+
+int react_prime_fileread(struct react_reg *r, int fd, void *buf, size_t len,
+                         ssize_t *rc, int *en)
+{
+  return submit(r, OP_READ, fd, buf, len, 0, rc, en);
+}
+
+int react_prime_filewrite(struct react_reg *r, int fd,
+                          const void *buf, size_t len,
+                          ssize_t *rc, int *en)
+{
+  return submit(r, OP_WRITE, fd, (void *) buf, len, 0, rc, en);
+}
+
+int react_prime_filepread(struct react_reg *r, int fd,
+                          void *buf, size_t len, off_t off,
+                          ssize_t *rc, int *en)
+{
+  return submit(r, OP_PREAD, fd, buf, len, off, rc, en);
+}
+
+int react_prime_filepwrite(struct react_reg *r, int fd,
+                           const void *buf, size_t len, off_t off,
+                           ssize_t *rc, int *en)
+{
+  return submit(r, OP_PWRITE, fd, (void *) buf, len, off, rc, en);
+}
+#endif
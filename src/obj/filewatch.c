@@ -0,0 +1,281 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/fd.h"
+#include "react/idle.h"
+#include "react/file.h"
+
+#if react_ALLOW_INOTIFY
+#include <unistd.h>
+#include <sys/inotify.h>
+
+/* Watches are found by hashing their descriptors into this many
+   buckets. */
+#define BUCKETS 64
+
+/* These are always reported. */
+#define ALWAYS (IN_IGNORED | IN_Q_OVERFLOW)
+
+struct react_watch {
+  struct react_watch *next;
+  int wd;
+
+  /* These are the events requested so far, and those that occurred
+     while nobody was waiting for them. */
+  uint32_t mask, pending;
+
+  /* These handles are waiting for events on this watch. */
+  struct react_reg *waiters;
+
+  /* This many handles have been primed on this watch, and not
+     cancelled since.  The watch is removed when none are left. */
+  size_t holders;
+
+  /* This is set when the watch has gone, and is no longer listed. */
+  unsigned gone : 1;
+};
+
+struct react_inotify {
+  /* This is the inotify descriptor, and the handle that watches it
+     while at least one handle is waiting. */
+  int fd;
+  struct react_reg *ev;
+  size_t waiting;
+
+  struct react_watch *buckets[BUCKETS];
+};
+
+static struct react_watch **find_watch(struct react_inotify *in, int wd)
+{
+  struct react_watch **pp = &in->buckets[(unsigned) wd % BUCKETS];
+  while (*pp && (*pp)->wd != wd)
+    pp = &(*pp)->next;
+  return pp;
+}
+
+/* Deliver events to the waiters, and keep those that nobody took. */
+static void deliver(struct react_watch *w, uint32_t bits)
+{
+  uint32_t taken = 0;
+  struct react_reg *next;
+  for (struct react_reg *r = w->waiters; r != react_ERROR; r = next) {
+    next = r->data.filewatch.next;
+    uint32_t got = bits & (r->data.filewatch.mask | ALWAYS);
+    if (got == 0) continue;
+    *r->data.filewatch.events = got;
+    taken |= got;
+    react_trigger(r);
+  }
+  w->pending |= bits & ~taken & (w->mask | ALWAYS);
+}
+
+static void on_events(void *ctxt)
+{
+  struct react_inotify *in = ctxt;
+
+  union {
+    struct inotify_event ev;
+    char buf[4096];
+  } u;
+  ssize_t got;
+  while ((got = read(in->fd, u.buf, sizeof u.buf)) > 0) {
+    for (char *p = u.buf; p < u.buf + got; ) {
+      const struct inotify_event *ev = (const void *) p;
+      p += sizeof *ev + ev->len;
+
+      if (ev->mask & IN_Q_OVERFLOW) {
+        /* Events have been lost, so tell everyone. */
+        for (size_t b = 0; b < BUCKETS; b++)
+          for (struct react_watch *w = in->buckets[b]; w; w = w->next)
+            deliver(w, IN_Q_OVERFLOW);
+        continue;
+      }
+
+      struct react_watch **pp = find_watch(in, ev->wd);
+      struct react_watch *w = *pp;
+      if (!w) continue;
+      deliver(w, ev->mask);
+
+      if (ev->mask & IN_IGNORED) {
+        /* The watch has gone, so stop listing it.  It is freed when
+           the last handle holding it lets go. */
+        *pp = w->next;
+        w->gone = 1;
+      }
+    }
+  }
+
+  if (in->waiting > 0)
+    react_prime_fdin(in->ev, in->fd);
+}
+
+static struct react_inotify *ensure_inotify(struct react_corestr *core)
+{
+  if (core->inotify) return core->inotify;
+
+  struct react_inotify *in = malloc(sizeof *in);
+  if (!in) {
+    errno = react_ENOMEM;
+    return NULL;
+  }
+  static const struct react_inotify null;
+  *in = null;
+  in->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (in->fd < 0) {
+    free(in);
+    return NULL;
+  }
+  in->ev = react_open(core);
+  if (in->ev == react_ERROR) {
+    close(in->fd);
+    free(in);
+    return NULL;
+  }
+  react_direct(in->ev, &on_events, in);
+  in->ev->internal = 1;
+  core->inotify = in;
+  return in;
+}
+
+void react_closeinotify(struct react_corestr *core)
+{
+  struct react_inotify *in = core->inotify;
+  if (!in) return;
+  core->inotify = NULL;
+  for (size_t b = 0; b < BUCKETS; b++)
+    while (in->buckets[b]) {
+      struct react_watch *w = in->buckets[b];
+      in->buckets[b] = w->next;
+      free(w);
+    }
+  react_close(in->ev);
+  close(in->fd);
+  free(in);
+}
+
+static void unhold(struct react_inotify *in, struct react_watch *w)
+{
+  if (--w->holders > 0) return;
+  if (!w->gone) {
+    /* Nobody wants the watch any more, so remove it.  The IN_IGNORED
+       event that follows will find no record, and be dropped. */
+    inotify_rm_watch(in->fd, w->wd);
+    *find_watch(in, w->wd) = w->next;
+  }
+  free(w);
+}
+
+void react_releasewatch(struct react_reg *r)
+{
+  struct react_watch *w = r->watch;
+  r->watch = NULL;
+  unhold(r->core->inotify, w);
+}
+
+static void defuse_filewatch(struct react_reg *r)
+{
+  struct react_inotify *in = r->core->inotify;
+  struct react_reg **pp = &r->watch->waiters;
+  while (*pp != r)
+    pp = &(*pp)->data.filewatch.next;
+  *pp = r->data.filewatch.next;
+  if (--in->waiting == 0)
+    react_cancel(in->ev);
+}
+
+int react_prime_filewatch(struct react_reg *r, const char *path,
+                          uint32_t mask, uint32_t *events)
+{
+  /* Keep the watch we already have until we hold the new one, so
+     that priming on the same file again doesn't remove it. */
+  struct react_watch *old = r->watch;
+  if (old) old->holders++;
+  react_cancel(r);
+
+  struct react_inotify *in = ensure_inotify(r->core);
+  if (!in) return -1;
+
+  struct react_watch *w = NULL;
+  int wd = inotify_add_watch(in->fd, path, mask | IN_MASK_ADD);
+  if (wd < 0) goto failed;
+
+  struct react_watch **pp = find_watch(in, wd);
+  w = *pp;
+  if (!w) {
+    w = malloc(sizeof *w);
+    if (!w) {
+      inotify_rm_watch(in->fd, wd);
+      errno = react_ENOMEM;
+      goto failed;
+    }
+    w->next = NULL;
+    w->wd = wd;
+    w->mask = 0;
+    w->pending = 0;
+    w->waiters = react_ERROR;
+    w->holders = 0;
+    w->gone = 0;
+    *pp = w;
+  }
+  w->mask |= mask;
+  w->holders++;
+  if (old) unhold(in, old);
+  old = NULL;
+
+  /* Report events that occurred since the last priming. */
+  uint32_t got = w->pending & (mask | ALWAYS);
+  if (got != 0) {
+    w->pending &= ~got;
+    *events = got;
+    if (react_prime_idle(r) < 0) goto failed;
+    r->watch = w;
+    return 0;
+  }
+
+  if (in->waiting == 0 && react_prime_fdin(in->ev, in->fd) < 0)
+    goto failed;
+  in->waiting++;
+  r->watch = w;
+  r->data.filewatch.mask = mask;
+  r->data.filewatch.events = events;
+  r->data.filewatch.next = w->waiters;
+  w->waiters = r;
+  r->act = &react_trigger;
+  r->defuse = &defuse_filewatch;
+  return 0;
+
+ failed:
+  {
+    int en = errno;
+    if (w) unhold(in, w);
+    if (old) unhold(in, old);
+    errno = en;
+  }
+  return -1;
+}
+#endif
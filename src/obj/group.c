@@ -0,0 +1,181 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <errno.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/idle.h"
+#include "react/group.h"
+
+static struct react_reg *find_member(struct react_reg *r, unsigned i)
+{
+  for (struct react_reg *m = r->members; m != react_ERROR;
+       m = m->member.next)
+    if (m->member.idx == i)
+      return m;
+  return react_ERROR;
+}
+
+/* Cancel the members the group is waiting for, and forget that they
+   fired. */
+static void cancel_members(struct react_reg *r, unsigned long mask)
+{
+  for (struct react_reg *m = r->members; m != react_ERROR;
+       m = m->member.next) {
+    if (!(mask & (1ul << m->member.idx))) continue;
+    react_cancel(m);
+    m->member.fired = 0;
+  }
+}
+
+static void defuse_group(struct react_reg *r)
+{
+  cancel_members(r, r->data.group.mask);
+}
+
+/* Get the members that have fired, or are about to. */
+static unsigned long fired_members(struct react_reg *r, unsigned long mask)
+{
+  unsigned long got = 0;
+  for (struct react_reg *m = r->members; m != react_ERROR;
+       m = m->member.next) {
+    unsigned long bit = 1ul << m->member.idx;
+    if ((mask & bit) && (m->member.fired || m->queued))
+      got |= bit;
+  }
+  return got;
+}
+
+static int satisfied(unsigned long got, unsigned long mask, int all)
+{
+  return all ? (got & mask) == mask : (got & mask) != 0;
+}
+
+static void on_member(void *ctxt)
+{
+  struct react_reg *m = ctxt;
+  struct react_reg *r = m->member.owner;
+  unsigned long bit = 1ul << m->member.idx;
+
+  /* Remember the event for when the group is primed. */
+  if (r->defuse != &defuse_group || !(r->data.group.mask & bit)) {
+    m->member.fired = 1;
+    return;
+  }
+
+  r->data.group.got |= bit;
+  if (!satisfied(r->data.group.got, r->data.group.mask, r->data.group.all))
+    return;
+
+  /* Include other members that fired at the same time.  Triggering
+     cancels the rest. */
+  *r->data.group.fired =
+    r->data.group.got | fired_members(r, r->data.group.mask);
+  react_trigger(r);
+}
+
+struct react_reg *react_member(struct react_reg *r, unsigned i)
+{
+  if (i >= react_GROUPMAX) {
+    errno = react_EINVAL;
+    return react_ERROR;
+  }
+
+  struct react_reg *m = find_member(r, i);
+  if (m != react_ERROR) return m;
+
+  m = react_open(r->core);
+  if (m == react_ERROR) return react_ERROR;
+  m->member.owner = r;
+  m->member.idx = i;
+  m->member.next = r->members;
+  r->members = m;
+  react_direct(m, &on_member, m);
+  m->internal = 1;
+  react_setprios(m, r->prio, r->subprio);
+  return m;
+}
+
+int react_prime_group(struct react_reg *r, unsigned long mask, int all,
+                      unsigned long *fired)
+{
+  if (mask == 0) {
+    errno = react_EINVAL;
+    return -1;
+  }
+
+  /* If re-priming, members that fired for the current priming are
+     only recorded in the group, so record them in the members
+     too. */
+  if (r->defuse == &defuse_group)
+    for (struct react_reg *m = r->members; m != react_ERROR;
+         m = m->member.next)
+      if (r->data.group.got & (1ul << m->member.idx))
+        m->member.fired = 1;
+
+  /* Every member must exist, and be waiting or have fired. */
+  unsigned long found = 0;
+  for (struct react_reg *m = r->members; m != react_ERROR;
+       m = m->member.next) {
+    unsigned long bit = 1ul << m->member.idx;
+    if (!(mask & bit)) continue;
+    if (!m->member.fired && !react_isactive(m)) {
+      errno = react_EBADSTATE;
+      return -1;
+    }
+    found |= bit;
+  }
+  if (found != mask) {
+    errno = react_EINVAL;
+    return -1;
+  }
+
+  /* Members that have yet to fire are processed at the group's
+     priority. */
+  for (struct react_reg *m = r->members; m != react_ERROR;
+       m = m->member.next)
+    if ((mask & (1ul << m->member.idx)) && !m->queued)
+      react_setprios(m, r->prio, r->subprio);
+
+  /* Re-priming must not cancel the members. */
+  if (r->defuse == &defuse_group)
+    r->defuse = NULL;
+  react_cancel(r);
+
+  /* Complete immediately if enough members have already fired. */
+  unsigned long got = fired_members(r, mask);
+  if (satisfied(got, mask, all)) {
+    *fired = got;
+    cancel_members(r, mask);
+    return react_prime_idle(r);
+  }
+
+  r->data.group.mask = mask;
+  r->data.group.got = got;
+  r->data.group.all = all;
+  r->data.group.fired = fired;
+  r->defuse = &defuse_group;
+  r->act = &react_trigger;
+  return 0;
+}
@@ -36,6 +36,7 @@ int react_prime_idle(struct react_reg *r)
   r->defuse = &defuse;
   r->act = &react_trigger;
   dllist_append(&r->core->idlers, data.idle.others, r);
+  react_corefdpoint(r->core);
 
   return 0;
 }
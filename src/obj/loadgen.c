@@ -0,0 +1,400 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Load generator for echod -b.  It opens many connections, and each
+   repeatedly sends a request and waits for it to be echoed in full.
+   The rate of completed requests and the distribution of their
+   round-trip times are reported at the end. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/times.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#define closesocket(S) close(S)
+
+#include "react/types.h"
+#include "react/core.h"
+#include "react/event.h"
+#include "react/socket.h"
+#include "react/time.h"
+
+struct lat {
+  size_t n, cap;
+  unsigned long long *v;
+};
+
+struct gen {
+  react_core_t core;
+  struct sockaddr_in addr;
+  size_t size;
+  const char *payload;
+  bool stop;
+  size_t live, abandoned;
+  unsigned long long requests, errors;
+  struct lat lat;
+};
+
+struct client {
+  struct gen *gen;
+  react_sock_t sock;
+  react_t ev;
+  char *buf;
+  size_t done;
+  unsigned long long start;
+  react_ssize_t rc;
+  int crc, en;
+};
+
+static unsigned long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static void add_lat(struct lat *l, unsigned long long ns)
+{
+  if (l->n == l->cap) {
+    size_t ncap = l->cap ? l->cap * 2 : 4096;
+    unsigned long long *nv = realloc(l->v, ncap * sizeof *nv);
+    if (nv == NULL) return;
+    l->v = nv;
+    l->cap = ncap;
+  }
+  l->v[l->n++] = ns;
+}
+
+static int cmp_ull(const void *va, const void *vb)
+{
+  const unsigned long long *a = va, *b = vb;
+  return *a < *b ? -1 : *a > *b;
+}
+
+static double pct_us(const struct lat *l, double p)
+{
+  if (l->n == 0) return 0;
+  return l->v[(size_t) (p / 100.0 * (l->n - 1) + 0.5)] / 1000.0;
+}
+
+static bool transient(int en)
+{
+  return en == EAGAIN || en == EWOULDBLOCK || en == EINTR;
+}
+
+static void drop(struct client *c)
+{
+  closesocket(c->sock);
+  react_close(c->ev);
+  c->gen->live--;
+  free(c->buf);
+  free(c);
+}
+
+static void on_recv(void *ctxt);
+static void on_send(void *ctxt);
+
+static void send_request(struct client *c)
+{
+  c->done = 0;
+  c->start = now_ns();
+  react_direct(c->ev, &on_send, c);
+  c->rc = 0;
+  c->en = 0;
+  on_send(c);
+}
+
+static void on_send(void *ctxt)
+{
+  struct client *c = ctxt;
+  struct gen *g = c->gen;
+  if (c->rc < 0 && !transient(c->en)) {
+    g->errors++;
+    drop(c);
+    return;
+  }
+  if (c->rc > 0)
+    c->done += c->rc;
+  if (c->done < g->size) {
+    int rc = react_prime_send(c->ev, c->sock, g->payload + c->done,
+                              g->size - c->done, 0, &c->rc, &c->en);
+    if (rc < 0) {
+      perror("react_prime_send");
+      drop(c);
+    }
+    return;
+  }
+
+  /* The request has gone, so wait for the whole echo. */
+  c->done = 0;
+  react_direct(c->ev, &on_recv, c);
+  int rc = react_prime_recv(c->ev, c->sock, c->buf, g->size, 0,
+                            &c->rc, &c->en);
+  if (rc < 0) {
+    perror("react_prime_recv");
+    drop(c);
+  }
+}
+
+static void on_recv(void *ctxt)
+{
+  struct client *c = ctxt;
+  struct gen *g = c->gen;
+  if (c->rc == 0 || (c->rc < 0 && !transient(c->en))) {
+    g->errors++;
+    drop(c);
+    return;
+  }
+  if (c->rc > 0)
+    c->done += c->rc;
+  if (c->done < g->size) {
+    int rc = react_prime_recv(c->ev, c->sock, c->buf + c->done,
+                              g->size - c->done, 0, &c->rc, &c->en);
+    if (rc < 0) {
+      perror("react_prime_recv");
+      drop(c);
+    }
+    return;
+  }
+
+  g->requests++;
+  add_lat(&g->lat, now_ns() - c->start);
+  if (g->stop)
+    drop(c);
+  else
+    send_request(c);
+}
+
+static void on_connect(void *ctxt)
+{
+  struct client *c = ctxt;
+  if (c->crc < 0 && c->en != EISCONN) {
+    errno = c->en;
+    perror("connect");
+    c->gen->errors++;
+    drop(c);
+    return;
+  }
+  send_request(c);
+}
+
+static int open_client(struct gen *g)
+{
+  struct client *c = malloc(sizeof *c);
+  if (c == NULL) return -1;
+  c->gen = g;
+  c->buf = malloc(g->size);
+  if (c->buf == NULL) {
+    free(c);
+    return -1;
+  }
+  c->sock = socket(PF_INET, SOCK_STREAM, 0);
+  if (c->sock == react_INVALID_SOCKET) {
+    free(c->buf);
+    free(c);
+    return -1;
+  }
+  int on = 1;
+  setsockopt(c->sock, IPPROTO_TCP, TCP_NODELAY, &on, sizeof on);
+  c->ev = react_open(g->core);
+  if (c->ev == react_ERROR) {
+    closesocket(c->sock);
+    free(c->buf);
+    free(c);
+    return -1;
+  }
+  g->live++;
+  react_direct(c->ev, &on_connect, c);
+  c->crc = 0;
+  if (react_prime_connect(c->ev, c->sock,
+                          (const struct sockaddr *) &g->addr,
+                          sizeof g->addr, &c->crc, &c->en) < 0) {
+    drop(c);
+    return -1;
+  }
+  return 0;
+}
+
+static void on_deadline(void *ctxt)
+{
+  struct gen *g = ctxt;
+  g->stop = true;
+}
+
+static void on_grace(void *ctxt)
+{
+  struct gen *g = ctxt;
+  g->abandoned = g->live;
+  g->live = 0;
+}
+
+int main(int argc, char *const *argv)
+{
+  size_t conns = 100;
+  double secs = 5;
+  bool json = false;
+  struct gen gen;
+  memset(&gen, 0, sizeof gen);
+  gen.size = 64;
+  gen.addr.sin_family = AF_INET;
+  gen.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  gen.addr.sin_port = htons(8000);
+
+  int c;
+  while ((c = getopt(argc, argv, "c:s:d:p:a:j")) != -1) {
+    switch (c) {
+    case 'c':
+      conns = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      gen.size = strtoul(optarg, NULL, 0);
+      break;
+    case 'd':
+      secs = atof(optarg);
+      break;
+    case 'p':
+      gen.addr.sin_port = htons(atoi(optarg));
+      break;
+    case 'a':
+      if (inet_pton(AF_INET, optarg, &gen.addr.sin_addr) != 1) {
+        fprintf(stderr, "%s: bad address %s\n", argv[0], optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'j':
+      json = true;
+      break;
+    default:
+      fprintf(stderr, "usage: %s [-j] [-c conns] [-s size] [-d secs]"
+              " [-a addr] [-p port]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (conns == 0 || gen.size == 0 || secs <= 0) {
+    fprintf(stderr, "%s: bad parameters\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  char *payload = malloc(gen.size);
+  if (payload == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  memset(payload, 'x', gen.size);
+  gen.payload = payload;
+
+  /* Make room for all the connections. */
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < conns + 16) {
+    rl.rlim_cur = conns + 16;
+    if (rl.rlim_cur > rl.rlim_max)
+      rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+
+  gen.core = react_opencore(0);
+  if (gen.core == react_COREERROR) {
+    perror("react_opencore");
+    return EXIT_FAILURE;
+  }
+
+  for (size_t i = 0; i < conns; i++)
+    if (open_client(&gen) < 0) {
+      perror("open_client");
+      break;
+    }
+
+  /* Stop issuing new requests after the deadline, and give up on
+     outstanding ones a second later. */
+  react_t deadline = react_open(gen.core);
+  react_direct(deadline, &on_deadline, &gen);
+  struct timespec when;
+  clock_gettime(CLOCK_REALTIME, &when);
+  when.tv_sec += (time_t) secs;
+  when.tv_nsec += (long) ((secs - (time_t) secs) * 1e9);
+  if (when.tv_nsec >= 1000000000) {
+    when.tv_sec++;
+    when.tv_nsec -= 1000000000;
+  }
+  react_prime_timespec(deadline, &when);
+  react_t grace = react_open(gen.core);
+  react_direct(grace, &on_grace, &gen);
+  when.tv_sec++;
+  react_prime_timespec(grace, &when);
+
+  struct tms t0, t1;
+  times(&t0);
+  unsigned long long start = now_ns();
+  while (gen.live > 0 || react_isprimed(deadline))
+    if (react_yield(gen.core) < 0) {
+      if (errno == EINTR) continue;
+      if (errno != EAGAIN)
+        perror("react_yield");
+      break;
+    }
+  double elapsed = (now_ns() - start) / 1e9;
+  if (gen.abandoned > 0)
+    fprintf(stderr, "%s: %zu requests abandoned\n", argv[0], gen.abandoned);
+  times(&t1);
+  double cpu = (double) (t1.tms_utime - t0.tms_utime +
+                         t1.tms_stime - t0.tms_stime) / sysconf(_SC_CLK_TCK);
+
+  react_close(deadline);
+  react_close(grace);
+  react_closecore(gen.core);
+
+  qsort(gen.lat.v, gen.lat.n, sizeof *gen.lat.v, &cmp_ull);
+  double rate = gen.requests / elapsed;
+  if (json)
+    printf("{\"conns\":%zu,\"size\":%zu,\"secs\":%.3f,\"requests\":%llu,"
+           "\"errors\":%llu,\"rps\":%.1f,\"cpu\":%.3f,"
+           "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,"
+           "\"p999_us\":%.1f,\"max_us\":%.1f}\n",
+           conns, gen.size, elapsed, gen.requests, gen.errors, rate, cpu,
+           pct_us(&gen.lat, 50), pct_us(&gen.lat, 90),
+           pct_us(&gen.lat, 99), pct_us(&gen.lat, 99.9),
+           pct_us(&gen.lat, 100));
+  else
+    printf("%zu connections, %zu-byte requests, %.3fs\n"
+           "%llu requests (%llu errors), %.1f req/s, %.3fs CPU\n"
+           "latency/us: p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           conns, gen.size, elapsed,
+           gen.requests, gen.errors, rate, cpu,
+           pct_us(&gen.lat, 50), pct_us(&gen.lat, 90),
+           pct_us(&gen.lat, 99), pct_us(&gen.lat, 99.9),
+           pct_us(&gen.lat, 100));
+  free(gen.lat.v);
+  free(payload);
+  return gen.errors || gen.abandoned ? EXIT_FAILURE : EXIT_SUCCESS;
+}
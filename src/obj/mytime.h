@@ -44,6 +44,17 @@ void react_systime_zero(delay_type *a);
 int react_systime_diff(delay_type *r,
                        const moment_type *a, const moment_type *b);
 
+/* Compute *a-*b in nanoseconds, or zero if negative.  This is used
+   for statistics, so it saturates rather than failing. */
+unsigned long long react_systime_nsdiff(const moment_type *a,
+                                        const moment_type *b);
+
+/* Express a time in nanoseconds since the Unix epoch. */
+unsigned long long react_systime_ns(const moment_type *);
+
+/* Advance a time by some nanoseconds. */
+void react_systime_addns(moment_type *, unsigned long long ns);
+
 const char *react_systime_fmt(const moment_type *);
 const char *react_systime_fmtdelay(const delay_type *);
 
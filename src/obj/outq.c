@@ -0,0 +1,293 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/fd.h"
+#include "react/outq.h"
+
+#if react_ALLOW_FD
+#include <unistd.h>
+#include <sys/uio.h>
+
+/* Data are copied into chunks of at least this size. */
+#define CHUNK_SIZE 16384
+
+/* This is the most segments gathered into one writev(). */
+#define MAX_IOV 64
+
+struct chunk {
+  struct chunk *next;
+
+  /* The pending data are from start to end. */
+  size_t start, end, cap;
+  unsigned char data[];
+};
+
+struct react_outqstr {
+  int fd;
+  size_t lowat, hiwat;
+  react_outqproc_t *func;
+  void *ctxt;
+
+  /* This waits for the descriptor to become writable while data are
+     pending. */
+  struct react_reg *wr;
+
+  /* This is the pending data, and an empty chunk kept for reuse. */
+  struct chunk *head, *tail, *spare;
+  size_t pending;
+
+  /* This is the error that stopped the queue, or zero. */
+  int err;
+  unsigned high : 1, corked : 1;
+};
+
+static void report(struct react_outqstr *q, react_outqev_t ev)
+{
+  if (q->func)
+    (*q->func)(q->ctxt, q, ev);
+}
+
+static int fail(struct react_outqstr *q, int en)
+{
+  q->err = en;
+  react_cancel(q->wr);
+  report(q, react_OUTQFAILED);
+  errno = en;
+  return -1;
+}
+
+/* Remove written bytes from the front of the queue. */
+static void consume(struct react_outqstr *q, size_t n)
+{
+  q->pending -= n;
+  while (n > 0) {
+    struct chunk *c = q->head;
+    size_t avail = c->end - c->start;
+    if (n < avail) {
+      c->start += n;
+      break;
+    }
+    n -= avail;
+    q->head = c->next;
+    if (q->head == NULL)
+      q->tail = NULL;
+    if (q->spare == NULL && c->cap == CHUNK_SIZE) {
+      c->start = c->end = 0;
+      c->next = NULL;
+      q->spare = c;
+    } else {
+      free(c);
+    }
+  }
+}
+
+/* Write out as much as possible, and wait to write the rest.  Return
+   negative on error, having reported it. */
+static int flush(struct react_outqstr *q)
+{
+  while (q->pending > 0) {
+    struct iovec iov[MAX_IOV];
+    int n = 0;
+    for (struct chunk *c = q->head; c != NULL && n < MAX_IOV; c = c->next) {
+      iov[n].iov_base = c->data + c->start;
+      iov[n].iov_len = c->end - c->start;
+      n++;
+    }
+    ssize_t rc = writev(q->fd, iov, n);
+    if (rc < 0) {
+      if (errno == EINTR) continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+      return fail(q, errno);
+    }
+    consume(q, rc);
+  }
+
+  if (q->pending > 0 && !react_isactive(q->wr) &&
+      react_prime_fdout(q->wr, q->fd) < 0)
+    return fail(q, errno);
+  return 0;
+}
+
+static void on_writable(void *ctxt)
+{
+  struct react_outqstr *q = ctxt;
+  if (flush(q) < 0) return;
+  if (q->high && q->pending <= q->lowat) {
+    q->high = 0;
+    report(q, react_OUTQLOW);
+  }
+}
+
+/* Copy data to the end of the queue. */
+static int append(struct react_outqstr *q, const unsigned char *p, size_t len)
+{
+  while (len > 0) {
+    struct chunk *c = q->tail;
+    if (c == NULL || c->end == c->cap) {
+      if (q->spare != NULL && len <= CHUNK_SIZE) {
+        c = q->spare;
+        q->spare = NULL;
+      } else {
+        size_t cap = len > CHUNK_SIZE ? len : CHUNK_SIZE;
+        c = malloc(sizeof *c + cap);
+        if (c == NULL) {
+          errno = react_ENOMEM;
+          return -1;
+        }
+        c->start = c->end = 0;
+        c->cap = cap;
+      }
+      c->next = NULL;
+      if (q->tail)
+        q->tail->next = c;
+      else
+        q->head = c;
+      q->tail = c;
+    }
+    size_t room = c->cap - c->end;
+    if (room > len) room = len;
+    memcpy(c->data + c->end, p, room);
+    c->end += room;
+    p += room;
+    len -= room;
+    q->pending += room;
+  }
+  return 0;
+}
+
+struct react_outqstr *react_openoutq(struct react_corestr *core, int fd,
+                                     size_t lowat, size_t hiwat,
+                                     react_outqproc_t *func, void *ctxt)
+{
+  if (lowat > hiwat) {
+    errno = EINVAL;
+    return react_OUTQERROR;
+  }
+  struct react_outqstr *q = malloc(sizeof *q);
+  if (q == NULL) {
+    errno = react_ENOMEM;
+    return react_OUTQERROR;
+  }
+  q->wr = react_open(core);
+  if (q->wr == react_ERROR) {
+    free(q);
+    return react_OUTQERROR;
+  }
+  react_direct(q->wr, &on_writable, q);
+  q->wr->internal = 1;
+  q->fd = fd;
+  q->lowat = lowat;
+  q->hiwat = hiwat;
+  q->func = func;
+  q->ctxt = ctxt;
+  q->head = q->tail = q->spare = NULL;
+  q->pending = 0;
+  q->err = 0;
+  q->high = q->corked = 0;
+  return q;
+}
+
+void react_closeoutq(struct react_outqstr *q)
+{
+  if (q == react_OUTQERROR) return;
+  react_close(q->wr);
+  while (q->head != NULL) {
+    struct chunk *c = q->head;
+    q->head = c->next;
+    free(c);
+  }
+  free(q->spare);
+  free(q);
+}
+
+int react_outqwrite(struct react_outqstr *q, const void *buf, size_t len)
+{
+  if (q->err != 0) {
+    errno = q->err;
+    return -1;
+  }
+  const unsigned char *p = buf;
+
+  /* Try to write straight away if nothing is in the way. */
+  if (q->pending == 0 && !q->corked) {
+    while (len > 0) {
+      ssize_t rc = write(q->fd, p, len);
+      if (rc < 0) {
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        return fail(q, errno);
+      }
+      p += rc;
+      len -= rc;
+    }
+    if (len == 0) return 0;
+  }
+
+  if (append(q, p, len) < 0)
+    return -1;
+  if (!q->corked && !react_isactive(q->wr) &&
+      react_prime_fdout(q->wr, q->fd) < 0)
+    return fail(q, errno);
+  if (!q->high && q->pending >= q->hiwat) {
+    q->high = 1;
+    report(q, react_OUTQHIGH);
+  }
+  return 0;
+}
+
+int react_outqcork(struct react_outqstr *q, int on)
+{
+  if (q->err != 0) {
+    errno = q->err;
+    return -1;
+  }
+  if (on) {
+    q->corked = 1;
+    return 0;
+  }
+  if (!q->corked) return 0;
+  q->corked = 0;
+  if (flush(q) < 0) return -1;
+  if (q->high && q->pending <= q->lowat) {
+    q->high = 0;
+    report(q, react_OUTQLOW);
+  }
+  return 0;
+}
+
+size_t react_outqpending(struct react_outqstr *q)
+{
+  return q->pending;
+}
+
+int react_outqerror(struct react_outqstr *q)
+{
+  return q->err;
+}
+#endif
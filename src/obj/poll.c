@@ -119,7 +119,14 @@ static void add_monitor(struct react_corestr *core, int fd, short evs)
   fprintf(stderr, "added %d%s\n", fd, evtext(evs));
 #endif
   assert((core->pollrec.base[fd] & evs) == 0);
+#if react_ALLOW_COREFD
+  short before = core->pollrec.base[fd];
+#endif
   core->pollrec.base[fd] |= evs & ALL_EVENTS & ~UNREQUESTED_EVENTS;
+#if react_ALLOW_COREFD
+  if (core->corefd)
+    react_corefdwatch(core, fd, before, core->pollrec.base[fd]);
+#endif
 }
 
 static int ensure_pollrecs(struct react_corestr *core, unsigned maxfd)
@@ -175,7 +182,14 @@ static void defuse_polls(struct react_reg *r)
 
     /* Mark the events as unwatched. */
     assert(ref->fd >= 0);
+#if react_ALLOW_COREFD
+    short before = core->pollrec.base[ref->fd];
+#endif
     core->pollrec.base[ref->fd] &= ~ref->origevs;
+#if react_ALLOW_COREFD
+    if (core->corefd)
+      react_corefdwatch(core, ref->fd, before, core->pollrec.base[ref->fd]);
+#endif
   }
 
   trim_array(core);
@@ -269,6 +283,10 @@ int react_prime_polls(struct react_reg *r, struct pollfd *base, nfds_t len)
     ep->fd = base[i].fd;
     ep->events = base[i].events & ALL_EVENTS;
 
+    /* The entry might have been released and reused while events are
+       being delivered, so it mustn't appear to have any. */
+    ep->revents = 0;
+
     /* Keep the original FD and events in case the user corrupts the
        table. */
     ref->fd = base[i].fd;
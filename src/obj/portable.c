@@ -163,6 +163,19 @@ void react_close(struct react_reg *r)
 
   react_cancel(r);
   react_close(r->subev);
+
+  /* Release the members of a group. */
+  while (r->members != react_ERROR)
+    react_close(r->members);
+
+  /* Leave the group this handle is a member of. */
+  if (r->member.owner != react_ERROR) {
+    struct react_reg **pp = &r->member.owner->members;
+    while (*pp != r)
+      pp = &(*pp)->member.next;
+    *pp = r->member.next;
+  }
+
   if (r->core)
     dllist_unlink(&r->core->members, in_core, r);
   free(r->dyn.mem);
@@ -171,8 +184,11 @@ void react_close(struct react_reg *r)
 
 struct react_reg *react_ensuresub(struct react_reg *r)
 {
-  if (r->subev == react_ERROR)
+  if (r->subev == react_ERROR) {
     r->subev = react_open(r->core);
+    if (r->subev != react_ERROR)
+      r->subev->internal = 1;
+  }
   return r->subev;
 }
 
@@ -194,6 +210,31 @@ void react_getprios(struct react_reg *r, react_prio_t *p, react_subprio_t *sp)
   *sp = r->subprio;
 }
 
+void react_optimistic(struct react_reg *r, int on)
+{
+  r->optimistic = !!on;
+}
+
+int react_isoptimistic(struct react_reg *r)
+{
+  return r->optimistic;
+}
+
+int react_wouldblock(struct react_reg *r, int failed)
+{
+  if (failed && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    r->core->stats.optimistic.misses++;
+    return 1;
+  }
+  r->core->stats.optimistic.hits++;
+
+  /* The completion is about to queue the handle.  If that happens
+     while dispatching, it must wait for the next yield. */
+  if (r->core->dispatching)
+    r->deferred = 1;
+  return 0;
+}
+
 int react_setprios(struct react_reg *r, react_prio_t p, react_subprio_t sp)
 {
   if (r->queued) {
@@ -254,22 +295,28 @@ void react_dequeue(struct react_reg *r)
 {
   if (!r || !r->queued) return;
 
-  react_prio_t p = r->prio;
-  assert(p < r->core->queues.size);
-  struct queue_set *sq = &r->core->queues.base[p];
-  react_prio_t sp = r->subprio;
-  assert(sp < sq->size);
-  dllist_unlink(&sq->base[sp], in_queue, r);
+  if (r->deferred) {
+    dllist_unlink(&r->core->deferred, in_queue, r);
+    r->deferred = 0;
+  } else {
+    react_prio_t p = r->prio;
+    assert(p < r->core->queues.size);
+    struct queue_set *sq = &r->core->queues.base[p];
+    react_prio_t sp = r->subprio;
+    assert(sp < sq->size);
+    dllist_unlink(&sq->base[sp], in_queue, r);
+  }
   r->queued = 0;
+  r->core->stats.queued--;
+  if (r->fresh) {
+    dllist_unlink(&r->core->fresh, in_fresh, r);
+    r->fresh = 0;
+  }
 }
 
-void react_queue(struct react_reg *r)
+/* Put a queued handle in its priority queue. */
+static void place(struct react_reg *r)
 {
-  /* Only event handles with user actions get queued. */
-  if (!r->proc) return;
-
-  if (r->queued) return;
-
   assert(r->prio < r->core->queues.size);
   struct queue_set *sq = &r->core->queues.base[r->prio];
   assert(r->subprio < sq->size);
@@ -282,7 +329,54 @@ void react_queue(struct react_reg *r)
 
   /* Add the event to the configured queue. */
   dllist_append(&sq->base[r->subprio], in_queue, r);
+}
+
+void react_queue(struct react_reg *r)
+{
+  /* Only a handle that has just completed optimistically is
+     deferred. */
+  const bool defer = r->deferred;
+  r->deferred = 0;
+
+  /* Only event handles with user actions get queued. */
+  if (!r->proc) return;
+
+  if (r->queued) return;
+
+  if (defer) {
+    /* Hold the handle back until the next yield, so that a procedure
+       that keeps re-priming it can't keep other events waiting. */
+    dllist_append(&r->core->deferred, in_queue, r);
+    r->deferred = 1;
+  } else {
+    place(r);
+  }
   r->queued = 1;
+
+  /* Record when the core woke to find this handle, or arrange to
+     record it when the core next wakes. */
+  if (r->core->dispatching) {
+    r->queued_at = r->core->woke;
+  } else {
+    dllist_append(&r->core->fresh, in_fresh, r);
+    r->fresh = 1;
+  }
+  react_tracepoint(r->core, react_TQUEUED, r, r->prio);
+
+  /* Keep track of the deepest the queues have been. */
+  if (++r->core->stats.queued > r->core->stats.queued_max)
+    r->core->stats.queued_max = r->core->stats.queued;
+  react_corefdpoint(r->core);
+}
+
+void react_undefer(struct react_corestr *core)
+{
+  for (struct react_reg *r = dllist_first(&core->deferred);
+       r != NULL; r = dllist_first(&core->deferred)) {
+    dllist_unlink(&core->deferred, in_queue, r);
+    r->deferred = 0;
+    place(r);
+  }
 }
 
 void react_trigger(struct react_reg *r)
@@ -294,6 +388,10 @@ void react_trigger(struct react_reg *r)
 void react_defuse(struct react_reg *r)
 {
   if (r) {
+    if (r->deadline.set) {
+      bheap_remove(&r->core->deadlines, r);
+      r->deadline.set = 0;
+    }
     defuse_proc_t *f = r->defuse;
     if (f) {
       r->defuse = 0;
@@ -303,10 +401,32 @@ void react_defuse(struct react_reg *r)
   }
 }
 
+void react_savedeadline(const struct react_reg *r, struct react_deadline *d)
+{
+  *d = r->deadline;
+}
+
+void react_restoredeadline(struct react_reg *r, const struct react_deadline *d)
+{
+  if (!d->set) return;
+  struct react_corestr *core = r->core;
+  if (r->deadline.set)
+    bheap_remove(&core->deadlines, r);
+  r->deadline.when = d->when;
+  r->deadline.expired = d->expired;
+  r->deadline.set = 1;
+  bheap_insert(&core->deadlines, r);
+  react_corefdpoint(core);
+}
+
 void react_cancel(struct react_reg *r)
 {
   react_defuse(r);
   react_dequeue(r);
+#if react_ALLOW_INOTIFY
+  if (r && r->watch)
+    react_releasewatch(r);
+#endif
 }
 
 void react_swapact(struct react_reg *r, action_proc_t *f, action_proc_t **fp)
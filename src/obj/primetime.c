@@ -22,6 +22,7 @@
  */
 
 #include <stdio.h>
+#include <errno.h>
 
 #include "common.h"
 #include "react/event.h"
@@ -40,6 +41,7 @@ static int prime_systime(struct react_reg *r, const moment_type *arg)
   struct react_corestr *core = r->core;
   r->data.systime.when = *arg;
   bheap_insert(&core->timed, r);
+  react_corefdpoint(core);
   r->act = &react_trigger;
   r->defuse = &defuse_time;
   return 0;
@@ -138,6 +140,51 @@ int react_prime_timespec(struct react_reg *r, const struct timespec *arg)
 }
 #endif
 
+#if react_ALLOW_TIMESPEC
+int react_deadline_timespec(struct react_reg *r, const struct timespec *arg,
+                            int *expired)
+{
+  if (expired) *expired = 0;
+
+  /* If the handle has already been triggered, there's nothing to
+     do. */
+  if (r->queued && r->defuse == 0)
+    return 0;
+  if (r->defuse == 0) {
+    errno = react_EBADSTATE;
+    return -1;
+  }
+
+  moment_type when;
+#if TIMEFMT_WINDOWS
+  ULARGE_INTEGER uli;
+  uli.QuadPart = 11644473600LL;
+  uli.QuadPart += arg->tv_sec;
+  uli.QuadPart *= 10000000LL;
+  uli.QuadPart += arg->tv_nsec / 100;
+  when.dwLowDateTime = uli.LowPart;
+  when.dwHighDateTime = uli.HighPart;
+#elif TIMEFMT_TIMEVAL || TIMEFMT_TIMEVALPOLL
+  when.tv_sec = arg->tv_sec;
+  when.tv_usec = arg->tv_nsec / 1000;
+#elif TIMEFMT_TIMESPEC
+  when = *arg;
+#else
+#error "No implementation"
+#endif
+
+  struct react_corestr *core = r->core;
+  if (r->deadline.set)
+    bheap_remove(&core->deadlines, r);
+  r->deadline.when = when;
+  r->deadline.expired = expired;
+  r->deadline.set = 1;
+  bheap_insert(&core->deadlines, r);
+  react_corefdpoint(core);
+  return 0;
+}
+#endif
+
 #if react_ALLOW_WINFILETIME
 int react_prime_winfiletime(struct react_reg *r, const FILETIME *arg)
 {
@@ -48,6 +48,7 @@ typedef int socklen_t;
 #include "react/core.h"
 #include "react/user.h"
 #include "react/socket.h"
+#include "react/relay.h"
 
 #if __STDC_VERSION__ < 199901L
 #error "C99 required"
@@ -60,10 +61,16 @@ typedef int socklen_t;
 #else
 #define closesocket(X) close(X)
 #define ioctlsocket(X,Y,Z) ioctl(X,Y,Z)
+#define ENABLE_RELAY 1
+#include <sys/uio.h>
 #endif
 
 #define BUFFER_SIZE 128
 
+/* This is the default ring-buffer size per direction in relay
+   mode. */
+#define RELAY_SIZE (256 * 1024)
+
 struct conn {
   dllist_elem(struct conn) others;
 
@@ -88,6 +95,18 @@ struct proxy {
   react_core_t core;
 
   struct sockaddr_in target;
+
+#if ENABLE_RELAY
+  /* In relay mode, this is the size of each ring buffer, and
+     connections are held in 'relays' instead.  Otherwise, it is
+     zero. */
+  size_t relay;
+  dllist_hdr(struct relay) relays;
+
+  /* If set, relays splice through pipes of this size (or the default
+     if 1), rather than copying through ring buffers. */
+  size_t splice;
+#endif
 };
 
 void close_conn(struct conn *conn)
@@ -409,6 +428,210 @@ static struct conn *open_conn(struct proxy *proxy,
   return NULL;
 }
 
+#if ENABLE_RELAY
+/* In relay mode, nothing is printed, both sockets are non-blocking,
+   and each direction has its own ring buffer and pair of handles, one
+   waiting to read from the source, and one waiting to write to the
+   destination.  The buffer is filled with readv() and emptied with
+   writev(), so a wrapped buffer still takes only one call each
+   way. */
+struct relay {
+  dllist_elem(struct relay) others;
+  struct proxy *proxy;
+  react_sock_t sock[2];
+
+#if react_ALLOW_FDSPLICE
+  /* In splice mode, the flows are unused, except for flow[0].wr to
+     wait for the connection, and this does all the work. */
+  react_relay_t splicer;
+  int en;
+#endif
+
+  struct flow {
+    struct relay *relay;
+    react_sock_t from, to;
+    react_t rd, wr;
+    unsigned char *buf;
+    size_t cap;
+
+    /* These count bytes read into and written from the buffer. */
+    unsigned long long in, out;
+    unsigned eof : 1, shut : 1;
+  } flow[2];
+};
+
+static void close_relay(struct relay *rl)
+{
+#if react_ALLOW_FDSPLICE
+  react_closerelay(rl->splicer);
+#endif
+  for (int i = 0; i < 2; i++) {
+    react_close(rl->flow[i].rd);
+    react_close(rl->flow[i].wr);
+    closesocket(rl->sock[i]);
+  }
+  dllist_unlink(&rl->proxy->relays, others, rl);
+  free(rl->flow[0].buf);
+  free(rl);
+}
+
+static int flow_pump(struct flow *f)
+{
+  struct iovec v[2];
+
+  /* Fill as much free space as we can. */
+  size_t fill = f->in - f->out;
+  if (!f->eof && fill < f->cap) {
+    size_t pos = f->in % f->cap;
+    size_t space = f->cap - fill;
+    size_t first = f->cap - pos;
+    if (first > space) first = space;
+    v[0].iov_base = f->buf + pos;
+    v[0].iov_len = first;
+    v[1].iov_base = f->buf;
+    v[1].iov_len = space - first;
+    ssize_t rc = readv(f->from, v, space > first ? 2 : 1);
+    if (rc > 0)
+      f->in += rc;
+    else if (rc == 0)
+      f->eof = 1;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      return -1;
+  }
+
+  /* Send as much stored data as we can. */
+  fill = f->in - f->out;
+  if (fill > 0) {
+    size_t pos = f->out % f->cap;
+    size_t first = f->cap - pos;
+    if (first > fill) first = fill;
+    v[0].iov_base = f->buf + pos;
+    v[0].iov_len = first;
+    v[1].iov_base = f->buf;
+    v[1].iov_len = fill - first;
+    ssize_t rc = writev(f->to, v, fill > first ? 2 : 1);
+    if (rc > 0)
+      f->out += rc;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+      return -1;
+  }
+
+  /* Pass on the end of the stream once it has been drained. */
+  if (f->eof && f->in == f->out && !f->shut) {
+    shutdown(f->to, SHUT_WR);
+    f->shut = 1;
+  }
+
+  /* Wait for whatever we couldn't do. */
+  if (!f->eof && f->in - f->out < f->cap && !react_isactive(f->rd) &&
+      react_prime_sockin(f->rd, f->from) < 0)
+    return -1;
+  if (f->in > f->out && !react_isactive(f->wr) &&
+      react_prime_sockout(f->wr, f->to) < 0)
+    return -1;
+  return 0;
+}
+
+static void on_flow(void *vf)
+{
+  struct flow *f = vf;
+  struct relay *rl = f->relay;
+  if (flow_pump(f) < 0 || (rl->flow[0].shut && rl->flow[1].shut))
+    close_relay(rl);
+}
+
+#if react_ALLOW_FDSPLICE
+static void on_relay_spliced(void *vr)
+{
+  close_relay(vr);
+}
+#endif
+
+static void on_relay_connected(void *vr)
+{
+  struct relay *rl = vr;
+  int err;
+  socklen_t errlen = sizeof err;
+  if (getsockopt(rl->sock[1], SOL_SOCKET, SO_ERROR, &err, &errlen) < 0 ||
+      err != 0) {
+    close_relay(rl);
+    return;
+  }
+#if react_ALLOW_FDSPLICE
+  if (rl->proxy->splice) {
+    /* Hand everything over to a splicing relay, and wait for it to
+       finish. */
+    rl->splicer =
+      react_openrelay(rl->proxy->core, rl->sock[0], rl->sock[1],
+                      rl->proxy->splice > 1 ? rl->proxy->splice : 0);
+    react_direct(rl->flow[0].wr, &on_relay_spliced, rl);
+    if (rl->splicer == react_RELAYERROR ||
+        react_prime_relay(rl->flow[0].wr, rl->splicer, &rl->en) < 0)
+      close_relay(rl);
+    return;
+  }
+#endif
+  react_direct(rl->flow[0].wr, &on_flow, &rl->flow[0]);
+  if (flow_pump(&rl->flow[0]) < 0 || flow_pump(&rl->flow[1]) < 0)
+    close_relay(rl);
+}
+
+static int open_relay(struct proxy *proxy, react_sock_t sock)
+{
+  react_ioctlflag_t flag = 1;
+  struct relay *rl = malloc(sizeof *rl);
+  if (rl == NULL) {
+    closesocket(sock);
+    return -1;
+  }
+  rl->proxy = proxy;
+#if react_ALLOW_FDSPLICE
+  rl->splicer = react_RELAYERROR;
+#endif
+  rl->sock[0] = sock;
+  rl->sock[1] = socket(PF_INET, SOCK_STREAM, 0);
+  unsigned char *buf =
+    proxy->splice ? NULL : malloc(proxy->relay * 2);
+  for (int i = 0; i < 2; i++) {
+    struct flow *f = &rl->flow[i];
+    f->relay = rl;
+    f->from = rl->sock[i];
+    f->to = rl->sock[!i];
+    f->buf = buf ? buf + i * proxy->relay : NULL;
+    f->cap = proxy->relay;
+    f->in = f->out = 0;
+    f->eof = f->shut = 0;
+    f->rd = react_open(proxy->core);
+    f->wr = react_open(proxy->core);
+    react_direct(f->rd, &on_flow, f);
+    react_direct(f->wr, &on_flow, f);
+  }
+  dllist_append(&proxy->relays, others, rl);
+
+  if ((buf == NULL && !proxy->splice) ||
+      rl->sock[1] == react_INVALID_SOCKET ||
+      rl->flow[0].rd == react_ERROR || rl->flow[0].wr == react_ERROR ||
+      rl->flow[1].rd == react_ERROR || rl->flow[1].wr == react_ERROR ||
+      ioctlsocket(rl->sock[0], FIONBIO, &flag) == react_SOCKET_ERROR ||
+      ioctlsocket(rl->sock[1], FIONBIO, &flag) == react_SOCKET_ERROR)
+    goto error;
+
+  /* Start connecting to the server, and wait to complete it. */
+  if (connect(rl->sock[1], (struct sockaddr *) &proxy->target,
+              sizeof proxy->target) == react_SOCKET_ERROR &&
+      errno != EINPROGRESS)
+    goto error;
+  react_direct(rl->flow[0].wr, &on_relay_connected, rl);
+  if (react_prime_sockout(rl->flow[0].wr, rl->sock[1]) < 0)
+    goto error;
+  return 0;
+
+ error:
+  close_relay(rl);
+  return -1;
+}
+#endif
+
 static int handle_accepting(struct proxy *proxy)
 {
   struct sockaddr_in from;
@@ -418,6 +641,10 @@ static int handle_accepting(struct proxy *proxy)
     accept(proxy->server, (struct sockaddr *) &from, &fromlen);
   if (sock == react_INVALID_SOCKET) {
     perror("accept");
+#if ENABLE_RELAY
+  } else if (proxy->relay) {
+    open_relay(proxy, sock);
+#endif
   } else {
     /* Create a new connection for this socket. */
     open_conn(proxy, &from, sock);
@@ -439,7 +666,8 @@ static void on_accepting(void *vp)
 
 int init_proxy(struct proxy *proxy, react_core_t core,
                const struct sockaddr_in *target,
-               const struct sockaddr_in *local)
+               const struct sockaddr_in *local,
+               size_t relay, size_t splice)
 {
   /* Set everything to a safe state. */
   proxy->accepting = react_ERROR;
@@ -447,6 +675,22 @@ int init_proxy(struct proxy *proxy, react_core_t core,
   dllist_init(&proxy->conns);
   proxy->core = core;
   proxy->target = *target;
+#if ENABLE_RELAY
+  proxy->relay = relay;
+  proxy->splice = splice;
+  dllist_init(&proxy->relays);
+#if !react_ALLOW_FDSPLICE
+  if (splice) {
+    errno = EINVAL;
+    return -1;
+  }
+#endif
+#else
+  if (relay || splice) {
+    errno = EINVAL;
+    return -1;
+  }
+#endif
 
   /* Try to open a reactor binding. */
   proxy->accepting = react_open(core);
@@ -530,18 +774,41 @@ int main(int argc, const char *const *argv)
   react_core_t core;
   struct sockaddr_in local, remote;
 
-  if (argc < 3) {
-    fprintf(stderr, "usage: %s local-addr remote-addr\n", argv[0]);
+  /* With -r, relay in bulk with large buffers, optionally of a given
+     size.  With -z, splice through pipes instead, optionally of a
+     given size. */
+  size_t relay = 0, splice = 0;
+  int argi = 1;
+  if (argi < argc && !strncmp(argv[argi], "-r", 2)) {
+    relay = argv[argi][2] ? strtoul(argv[argi] + 2, NULL, 0) : RELAY_SIZE;
+    if (relay == 0) {
+      fprintf(stderr, "%s: bad relay size %s\n", argv[0], argv[argi] + 2);
+      return EXIT_FAILURE;
+    }
+    argi++;
+  } else if (argi < argc && !strncmp(argv[argi], "-z", 2)) {
+    splice = argv[argi][2] ? strtoul(argv[argi] + 2, NULL, 0) : 1;
+    if (splice == 0) {
+      fprintf(stderr, "%s: bad pipe size %s\n", argv[0], argv[argi] + 2);
+      return EXIT_FAILURE;
+    }
+    relay = RELAY_SIZE;
+    argi++;
+  }
+
+  if (argc - argi < 2) {
+    fprintf(stderr, "usage: %s [-r[size]|-z[size]] local-addr remote-addr\n",
+            argv[0]);
     return EXIT_FAILURE;
   }
 
-  if (getaddr(&local, argv[1]) < 0) {
-    fprintf(stderr, "%s: couldn't resolve %s\n", argv[0], argv[1]);
+  if (getaddr(&local, argv[argi]) < 0) {
+    fprintf(stderr, "%s: couldn't resolve %s\n", argv[0], argv[argi]);
     return EXIT_FAILURE;
   }
 
-  if (getaddr(&remote, argv[2]) < 0) {
-    fprintf(stderr, "%s: couldn't resolve %s\n", argv[0], argv[2]);
+  if (getaddr(&remote, argv[argi + 1]) < 0) {
+    fprintf(stderr, "%s: couldn't resolve %s\n", argv[0], argv[argi + 1]);
     return EXIT_FAILURE;
   }
 
@@ -552,7 +819,7 @@ int main(int argc, const char *const *argv)
   core = react_opencore(3);
   if (core != react_COREERROR) {
     struct proxy proxy;
-    if (init_proxy(&proxy, core, &remote, &local) < 0) {
+    if (init_proxy(&proxy, core, &remote, &local, relay, splice) < 0) {
       perror("init_proxy");
       rc = EXIT_FAILURE;
     } else {
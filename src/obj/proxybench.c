@@ -0,0 +1,356 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Bulk-transfer benchmark for proxy and cppproxy.  It runs the given
+   proxy program between a local port and a sink of its own, pushes
+   a number of bytes through it on one or more streams, and reports
+   the throughput and the proxy's CPU time per byte. */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "react/types.h"
+#include "react/core.h"
+#include "react/event.h"
+#include "react/socket.h"
+
+#define CHUNK (256 * 1024)
+
+struct bench {
+  react_core_t core;
+  char *chunk;
+  unsigned long long sent, got, total;
+  size_t sources, sinks;
+  bool failed;
+};
+
+struct stream {
+  struct bench *b;
+  react_t ev;
+  react_sock_t sock;
+  unsigned long long left;
+  react_ssize_t rc;
+  int en;
+  char *buf;
+};
+
+static unsigned long long now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static bool transient(int en)
+{
+  return en == EAGAIN || en == EWOULDBLOCK || en == EINTR;
+}
+
+static void end_stream(struct stream *s)
+{
+  react_close(s->ev);
+  close(s->sock);
+  free(s->buf);
+  free(s);
+}
+
+static void on_sent(void *ctxt)
+{
+  struct stream *s = ctxt;
+  struct bench *b = s->b;
+  if (s->rc < 0 && !transient(s->en)) {
+    errno = s->en;
+    perror("send");
+    b->failed = true;
+    b->sources--;
+    end_stream(s);
+    return;
+  }
+  if (s->rc > 0) {
+    s->left -= s->rc;
+    b->sent += s->rc;
+  }
+  if (s->left == 0) {
+    shutdown(s->sock, SHUT_WR);
+    b->sources--;
+    end_stream(s);
+    return;
+  }
+  size_t len = s->left < CHUNK ? s->left : CHUNK;
+  if (react_prime_send(s->ev, s->sock, b->chunk, len, 0,
+                       &s->rc, &s->en) < 0) {
+    perror("react_prime_send");
+    b->failed = true;
+  }
+}
+
+static void on_received(void *ctxt)
+{
+  struct stream *s = ctxt;
+  struct bench *b = s->b;
+  if (s->rc == 0 || (s->rc < 0 && !transient(s->en))) {
+    if (s->rc < 0) {
+      errno = s->en;
+      perror("recv");
+      b->failed = true;
+    }
+    b->sinks--;
+    end_stream(s);
+    return;
+  }
+  if (s->rc > 0)
+    b->got += s->rc;
+  if (react_prime_recv(s->ev, s->sock, s->buf, CHUNK, 0,
+                       &s->rc, &s->en) < 0) {
+    perror("react_prime_recv");
+    b->failed = true;
+  }
+}
+
+static struct stream *open_stream(struct bench *b, react_sock_t sock,
+                                  react_proc_t *proc)
+{
+  struct stream *s = malloc(sizeof *s);
+  if (s == NULL) return NULL;
+  s->b = b;
+  s->sock = sock;
+  s->left = 0;
+  s->rc = -1;
+  s->en = EAGAIN;
+  s->buf = NULL;
+  s->ev = react_open(b->core);
+  if (s->ev == react_ERROR) {
+    free(s);
+    return NULL;
+  }
+  react_direct(s->ev, proc, s);
+  fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+  return s;
+}
+
+static react_sock_t connect_retry(const struct sockaddr_in *addr)
+{
+  /* The proxy might not be listening yet. */
+  for (int tries = 0; tries < 100; tries++) {
+    react_sock_t sock = socket(PF_INET, SOCK_STREAM, 0);
+    if (sock == react_INVALID_SOCKET) return sock;
+    if (connect(sock, (const struct sockaddr *) addr, sizeof *addr) == 0)
+      return sock;
+    close(sock);
+    if (errno != ECONNREFUSED) break;
+    usleep(50000);
+  }
+  return react_INVALID_SOCKET;
+}
+
+static double tv_secs(const struct timeval *tv)
+{
+  return tv->tv_sec + tv->tv_usec / 1e6;
+}
+
+int main(int argc, char *const *argv)
+{
+  unsigned long long total = 4ull << 30;
+  size_t streams = 1;
+  int port = 9100;
+  bool json = false;
+
+  int c;
+  while ((c = getopt(argc, argv, "+n:c:p:j")) != -1) {
+    switch (c) {
+    case 'n':
+      total = strtoull(optarg, NULL, 0);
+      break;
+    case 'c':
+      streams = strtoul(optarg, NULL, 0);
+      break;
+    case 'p':
+      port = atoi(optarg);
+      break;
+    case 'j':
+      json = true;
+      break;
+    default:
+      goto usage;
+    }
+  }
+  if (optind >= argc || streams == 0 || total < streams) {
+  usage:
+    fprintf(stderr, "usage: %s [-j] [-n bytes] [-c streams] [-p port]"
+            " proxy-program [proxy-options...]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  signal(SIGPIPE, SIG_IGN);
+
+  /* Listen where the proxy will connect to. */
+  struct sockaddr_in proxy_addr, sink_addr;
+  memset(&sink_addr, 0, sizeof sink_addr);
+  sink_addr.sin_family = AF_INET;
+  sink_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  sink_addr.sin_port = htons(port + 1);
+  proxy_addr = sink_addr;
+  proxy_addr.sin_port = htons(port);
+  react_sock_t lsock = socket(PF_INET, SOCK_STREAM, 0);
+  int on = 1;
+  setsockopt(lsock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof on);
+  if (bind(lsock, (struct sockaddr *) &sink_addr, sizeof sink_addr) < 0 ||
+      listen(lsock, SOMAXCONN) < 0) {
+    perror("sink");
+    return EXIT_FAILURE;
+  }
+
+  /* Run the proxy between the two ports, with its chatter
+     discarded. */
+  char local[40], remote[40];
+  snprintf(local, sizeof local, "127.0.0.1:%d", port);
+  snprintf(remote, sizeof remote, "127.0.0.1:%d", port + 1);
+  size_t nargs = argc - optind;
+  char **args = malloc((nargs + 3) * sizeof *args);
+  memcpy(args, argv + optind, nargs * sizeof *args);
+  args[nargs] = local;
+  args[nargs + 1] = remote;
+  args[nargs + 2] = NULL;
+  pid_t child = fork();
+  if (child < 0) {
+    perror("fork");
+    return EXIT_FAILURE;
+  }
+  if (child == 0) {
+    close(lsock);
+    int nul = open("/dev/null", O_WRONLY);
+    if (nul >= 0) dup2(nul, 1);
+    execvp(args[0], args);
+    perror(args[0]);
+    _exit(EXIT_FAILURE);
+  }
+
+  struct bench b;
+  memset(&b, 0, sizeof b);
+  b.total = total;
+  b.chunk = malloc(CHUNK);
+  memset(b.chunk, 'x', CHUNK);
+  b.core = react_opencore(0);
+
+  /* Connect each source through the proxy, and accept its sink. */
+  struct stream **ends = calloc(streams * 2, sizeof *ends);
+  for (size_t i = 0; i < streams; i++) {
+    react_sock_t src = connect_retry(&proxy_addr);
+    if (src == react_INVALID_SOCKET) {
+      perror("connect");
+      b.failed = true;
+      break;
+    }
+    react_sock_t dst = accept(lsock, NULL, NULL);
+    if (dst == react_INVALID_SOCKET) {
+      perror("accept");
+      close(src);
+      b.failed = true;
+      break;
+    }
+    struct stream *tx = open_stream(&b, src, &on_sent);
+    struct stream *rx = tx ? open_stream(&b, dst, &on_received) : NULL;
+    char *buf = rx ? malloc(CHUNK) : NULL;
+    if (buf == NULL) {
+      perror("open_stream");
+      if (rx) end_stream(rx); else close(dst);
+      if (tx) end_stream(tx); else close(src);
+      b.failed = true;
+      break;
+    }
+    tx->left = total / streams + (i < total % streams);
+    rx->buf = buf;
+    ends[i * 2] = tx;
+    ends[i * 2 + 1] = rx;
+    b.sources++;
+    b.sinks++;
+  }
+
+  struct rusage ru0, ru1;
+  getrusage(RUSAGE_SELF, &ru0);
+  unsigned long long start = now_ns();
+
+  /* Each end acts as if a call had failed transiently, which makes it
+     issue its first real one. */
+  for (size_t i = 0; i < b.sources * 2; i++)
+    (*(i % 2 ? &on_received : &on_sent))(ends[i]);
+  free(ends);
+
+  while (!b.failed && (b.sources > 0 || b.sinks > 0))
+    if (react_yield(b.core) < 0 && errno != EINTR) {
+      perror("react_yield");
+      b.failed = true;
+    }
+
+  double elapsed = (now_ns() - start) / 1e9;
+  getrusage(RUSAGE_SELF, &ru1);
+
+  /* Stop the proxy, and find out how much CPU it used. */
+  struct rusage pru;
+  int status;
+  kill(child, SIGTERM);
+  if (wait4(child, &status, 0, &pru) < 0) {
+    perror("wait4");
+    memset(&pru, 0, sizeof pru);
+  }
+  react_closecore(b.core);
+  close(lsock);
+
+  double pcpu = tv_secs(&pru.ru_utime) + tv_secs(&pru.ru_stime);
+  double scpu = tv_secs(&ru1.ru_utime) - tv_secs(&ru0.ru_utime) +
+    tv_secs(&ru1.ru_stime) - tv_secs(&ru0.ru_stime);
+  double gbps = b.got * 8 / elapsed / 1e9;
+  double nspb = b.got ? pcpu * 1e9 / b.got : 0;
+  if (json)
+    printf("{\"program\":\"%s\",\"streams\":%zu,\"bytes\":%llu,"
+           "\"secs\":%.3f,\"gbps\":%.3f,\"proxy_cpu\":%.3f,"
+           "\"proxy_ns_per_byte\":%.4f,\"bench_cpu\":%.3f}\n",
+           args[0], streams, b.got, elapsed, gbps, pcpu, nspb, scpu);
+  else
+    printf("%s: %llu bytes on %zu streams in %.3fs, %.3f Gbit/s\n"
+           "proxy CPU %.3fs (%.4f ns/byte), benchmark CPU %.3fs\n",
+           args[0], b.got, streams, elapsed, gbps, pcpu, nspb, scpu);
+  free(args);
+  free(b.chunk);
+
+  if (b.got != total) {
+    fprintf(stderr, "%s: only %llu of %llu bytes arrived\n",
+            argv[0], b.got, total);
+    return EXIT_FAILURE;
+  }
+  return b.failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
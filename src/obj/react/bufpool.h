@@ -0,0 +1,71 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_bufpool_HDRINCLUDED
+#define react_bufpool_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+  /* This is a buffer drawn from a pool.  Buffers can be linked into a
+     chain through 'next'.  The data occupy the first 'len' bytes at
+     'base', and there is room for 'cap'. */
+  struct react_buf {
+    struct react_buf *next;
+    unsigned char *base;
+    size_t len, cap;
+  };
+
+  /* This is an opaque handle for a pool of equally sized buffers.
+     react_BUFPOOLERROR symbolizes a permanent invalid value. */
+  typedef struct react_bufpoolstr *react_bufpool_t;
+#define react_BUFPOOLERROR ((struct react_bufpoolstr *) 0)
+
+  /* Create a pool of buffers of 'bufsize' bytes each, retaining up to
+     'keep' returned buffers for reuse.  Return react_BUFPOOLERROR on
+     error, with errno set. */
+  react_bufpool_t react_openbufpool(size_t bufsize, size_t keep);
+
+  /* Release the pool and its retained buffers.  All buffers taken
+     from the pool must have been returned first. */
+  void react_closebufpool(react_bufpool_t);
+
+  /* Take an empty buffer from the pool.  Return null on error, with
+     errno == react_ENOMEM. */
+  struct react_buf *react_getbuf(react_bufpool_t);
+
+  /* Return a chain of buffers to the pool.  The chain may be
+     null. */
+  void react_putbufs(react_bufpool_t, struct react_buf *);
+
+  /* Get the total number of bytes in a chain. */
+  size_t react_chainlen(const struct react_buf *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_child_HDRINCLUDED
+#define react_child_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "features.h"
+#include "types.h"
+
+#if react_ALLOW_PIDFD
+#include <sys/types.h>
+
+  /* Prime a handle to be queued when child process 'pid' ends.  The
+     child is then reaped, and its status, as from waitpid(), is
+     stored in '*status'.  If reaping fails, '*en' is set to the
+     error, otherwise to zero.  Return negative on error, with errno
+     set. */
+  int react_prime_child(react_t, pid_t pid, int *status, int *en);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
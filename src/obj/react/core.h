@@ -63,6 +63,47 @@ extern "C" {
      handles, EINTR if a signal occurred, or possibly other values. */
   int react_yield(react_core_t);
 
+  /* Yield control to a reactor, but without waiting for events.  Only
+     events that have already occurred are detected, and handles that
+     are already queued are processed.  Return negative on error, as
+     for react_yield(), except that it does not fail with EAGAIN. */
+  int react_yield_nowait(react_core_t);
+
+  /* Repeatedly yield control to a reactor, until react_stop() is
+     called, or until 'ns' nanoseconds have passed, or 'max' handles
+     have been processed, not counting those the library uses
+     internally.  Zero means no limit.  Return zero when
+     stopped or a limit is reached, or negative on error, with errno
+     set as for react_yield(), or to react_EBADSTATE if a loop is
+     already running. */
+  int react_run_for(react_core_t, unsigned long long ns, unsigned long max);
+
+  /* Yield control to a reactor until react_stop() is called, or
+     nothing is left to wait for. */
+  int react_run(react_core_t);
+
+  /* Make a run loop return promptly, having processed the handle it
+     is processing, if any.  If no loop is running, the next one
+     returns straight away.  This may be called from any thread. */
+  void react_stop(react_core_t);
+
+#if react_ALLOW_COREFD
+  /* Get a descriptor that is readable whenever the core has work to
+     do, i.e., a watched descriptor is ready, a timed event is due, or
+     handles are queued or idle.  It can be watched by another event
+     loop (even another core), and react_yield_nowait() called when
+     it is readable.  The descriptor belongs to the core.  Return
+     negative on error, with errno set, e.g., to ENOSYS if the core
+     does not use poll(). */
+  int react_getfd(react_core_t);
+#endif
+
+  /* Spin for up to 'max_ns' nanoseconds, checking for events without
+     blocking, before waiting for them.  The actual spin adapts
+     between zero and this limit, according to how long waits turn
+     out to be.  Zero, the default, disables spinning. */
+  void react_setspin(react_core_t, unsigned long long max_ns);
+
 #ifdef BUFSIZ
   void react_debug(react_core_t, FILE *, unsigned lvl);
 #endif
@@ -28,6 +28,7 @@
 #include <memory>
 
 #include "core.h"
+#include "stats.h"
 
 #include "prio.hh"
 #include "handler.hh"
@@ -61,6 +62,12 @@ namespace react {
     void debug(FILE *, unsigned lvl);
 #endif
 
+    /* Get a snapshot of the core's runtime statistics. */
+    void stats(react_stats &);
+
+    /* Enable or disable timing of handle procedures. */
+    void profile(bool on);
+
     react_deprecated(prio_t minprio());
     react_deprecated(prio_t maxprio());
 
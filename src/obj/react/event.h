@@ -108,6 +108,21 @@ extern "C" {
   void react_getprios(struct react_reg *,
                       react_prio_t *majp, react_subprio_t *minp);
 
+  /* Enable (on != 0) or disable optimistic priming of an event
+     handle.  When enabled, proactor-style priming functions such as
+     react_prime_recv(), react_prime_read() and react_prime_accept()
+     first attempt their operation.  If it does not fail with EAGAIN
+     or EWOULDBLOCK, its results are written, and the handle is
+     triggered immediately, without consulting the system.  Otherwise,
+     the handle is primed as usual.
+
+     Socket reception and transmission are attempted with
+     MSG_DONTWAIT, where available.  Other operations block if the
+     descriptor does, so it must be non-blocking.  The default is
+     disabled. */
+  void react_optimistic(struct react_reg *, int on);
+  int react_isoptimistic(struct react_reg *);
+
 #ifdef __cplusplus
 }
 #endif
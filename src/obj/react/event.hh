@@ -27,6 +27,7 @@
 #include <memory>
 
 #include "event.h"
+#include "stats.h"
 
 #include "prio.hh"
 #include "handler.hh"
@@ -60,6 +61,7 @@ namespace react {
     bool triggered() { return react_istriggered(h); }
     bool active() { return react_isactive(h); }
     void trigger() { react_trigger(h); }
+    void label(const char *s) { react_label(h, s); }
   };
 
   typedef std::shared_ptr<Event_base> Event;
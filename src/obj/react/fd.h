@@ -60,6 +60,20 @@ extern "C" {
 #endif
 #endif
 
+#if react_ALLOW_SENDFILE
+  /* Send up to 'count' bytes from a file to a socket with sendfile()
+     when the socket is writable, starting from and advancing *offset,
+     or the file position if 'offset' is null.  The _all variant keeps
+     going until the count is exhausted, the file ends, or the socket
+     is full. */
+  int react_prime_sendfile(struct react_reg *, int sock, int fd,
+                           off_t *offset, size_t count,
+                           ssize_t *rc, int *en);
+  int react_prime_sendfile_all(struct react_reg *, int sock, int fd,
+                               off_t *offset, size_t count,
+                               ssize_t *rc, int *en);
+#endif
+
   struct iovec;
   int react_prime_readv(struct react_reg *, int fd,
                         const struct iovec *, int, ssize_t *, int *en);
@@ -62,6 +62,22 @@
 #define react_ALLOW_ACCEPT4 1
 #endif
 
+#if defined __unix || defined __unix__
+#define react_ALLOW_SOCKMSG 1
+#endif
+
+#if react_ALLOW_SOCKMSG && _GNU_SOURCE
+#define react_ALLOW_SOCKMMSG 1
+#endif
+
+#if react_ALLOW_SOCKMSG && defined __linux__
+#define react_ALLOW_UDPGSO 1
+#endif
+
+#if react_ALLOW_SOCKMSG && defined __linux__
+#define react_ALLOW_BUSYPOLL 1
+#endif
+
 #ifdef __WIN32__
 #define react_ALLOW_WINFILETIME 1
 #define react_ALLOW_WINHANDLE 1
@@ -102,6 +118,34 @@
 #define react_ALLOW_FDSPLICE 1
 #endif
 
+#if react_ALLOW_FD && react_ALLOW_POLL && defined __linux__
+#define react_ALLOW_ZEROCOPY 1
+#endif
+
+#if react_ALLOW_FD && defined __linux__
+#define react_ALLOW_SENDFILE 1
+#endif
+
+#if react_ALLOW_FD && react_ALLOW_INTR && defined __linux__
+#define react_ALLOW_SIGNALFD 1
+#endif
+
+#if react_ALLOW_FD && defined __linux__
+#define react_ALLOW_PIDFD 1
+#endif
+
+#if react_ALLOW_FILE && react_IMPL_FILE_FD
+#define react_ALLOW_FILEIO 1
+#endif
+
+#if react_ALLOW_FD && defined __linux__
+#define react_ALLOW_INOTIFY 1
+#endif
+
+#if react_ALLOW_POLLS && defined __linux__
+#define react_ALLOW_COREFD 1
+#endif
+
 #define react_OCF_SCL_ENABLED 0u
 
 #if defined __riscos || defined __riscos__
@@ -34,6 +34,50 @@ extern "C" {
   int react_prime_fileexc(struct react_reg *r, int fd);
 #endif
 
+#if react_ALLOW_FILEIO
+#include <stddef.h>
+#include <sys/types.h>
+
+  /* Set the number of threads that perform file operations for the
+     core.  This must be done before the first operation.  Return
+     negative on error, with errno == react_EBADSTATE if too late, or
+     react_EINVAL if 'n' is zero. */
+  int react_setfilethreads(react_core_t, unsigned n);
+
+  /* Prime a handle to be queued when a read or write on a file has
+     been performed by another thread.  The number of bytes
+     transferred is stored in '*rc', and '*en' is set to zero, or to
+     the error.  The buffer must remain valid until the handle is
+     queued or cancelled.  Cancelling waits for an operation already
+     under way.  Return negative on error, with errno set. */
+  int react_prime_fileread(struct react_reg *r, int fd,
+                           void *buf, size_t len,
+                           ssize_t *rc, int *en);
+  int react_prime_filewrite(struct react_reg *r, int fd,
+                            const void *buf, size_t len,
+                            ssize_t *rc, int *en);
+  int react_prime_filepread(struct react_reg *r, int fd,
+                            void *buf, size_t len, off_t off,
+                            ssize_t *rc, int *en);
+  int react_prime_filepwrite(struct react_reg *r, int fd,
+                             const void *buf, size_t len, off_t off,
+                             ssize_t *rc, int *en);
+#endif
+
+#if react_ALLOW_INOTIFY
+#include <stdint.h>
+
+  /* Prime a handle to be queued when any of the inotify events in
+     'mask' occurs on 'path', and store the events in '*events'.
+     IN_IGNORED is always reported, and means that the watch has gone.
+     Otherwise, the watch lasts until no handle primed on it remains
+     uncancelled, and events occurring between primings are reported
+     by the next.
+     Return negative on error, with errno set. */
+  int react_prime_filewatch(struct react_reg *r, const char *path,
+                            uint32_t mask, uint32_t *events);
+#endif
+
 #if react_ALLOW_STDFILE
 #ifdef FILENAME_MAX
   int react_prime_stdfilein(struct react_reg *r, FILE *);
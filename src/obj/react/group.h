@@ -0,0 +1,62 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_group_HDRINCLUDED
+#define react_group_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <limits.h>
+
+#include "types.h"
+
+  /* This is the number of members a group handle can have. */
+#define react_GROUPMAX (sizeof(unsigned long) * CHAR_BIT)
+
+  /* Get member 'i' of a group handle, creating it if necessary.  A
+     member is an ordinary handle, and can be primed in any way, but
+     its procedure belongs to the group, and must not be changed.
+     Members are released with the group, or can be released
+     individually.  Return react_ERROR on error, with errno ==
+     react_EINVAL if 'i' is not less than react_GROUPMAX, or
+     react_ENOMEM if out of memory. */
+  react_t react_member(react_t, unsigned i);
+
+  /* Prime a handle on some of its members, identified by bits of
+     'mask'.  If 'all' is zero, the handle is triggered when any of
+     them fires, otherwise when all have.  When triggered, the members
+     that fired are indicated in '*fired', and the rest are
+     cancelled.  Return negative on error, with errno ==
+     react_EINVAL if 'mask' is zero or identifies a non-existent
+     member, or react_EBADSTATE if a member is neither primed nor
+     fired. */
+  int react_prime_group(react_t, unsigned long mask, int all,
+                        unsigned long *fired);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,95 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_outq_HDRINCLUDED
+#define react_outq_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "features.h"
+#include "types.h"
+
+#if react_ALLOW_FD
+  /* This is an opaque handle for an output queue, which buffers data
+     for a descriptor, and writes it out as the descriptor allows.
+     react_OUTQERROR symbolizes a permanent invalid value. */
+  typedef struct react_outqstr *react_outq_t;
+#define react_OUTQERROR ((struct react_outqstr *) 0)
+
+  /* These are the events reported by an output queue. */
+  typedef enum {
+    /* The amount pending has reached the high watermark. */
+    react_OUTQHIGH,
+
+    /* The amount pending has fallen to the low watermark, having
+       reached the high watermark. */
+    react_OUTQLOW,
+
+    /* Writing failed, and the queue has stopped.  The error is
+       available from react_outqerror(). */
+    react_OUTQFAILED,
+  } react_outqev_t;
+
+  /* This is invoked to report an event.  The queue may be closed from
+     within it. */
+  typedef void react_outqproc_t(void *ctxt, react_outq_t, react_outqev_t);
+
+  /* Create an output queue for a non-blocking descriptor, with
+     watermarks for backpressure.  'func' may be null.  Return
+     react_OUTQERROR on error, with errno set. */
+  react_outq_t react_openoutq(react_core_t, int fd,
+                              size_t lowat, size_t hiwat,
+                              react_outqproc_t *func, void *ctxt);
+
+  /* Discard pending data, and release the queue.  The descriptor is
+     left open. */
+  void react_closeoutq(react_outq_t);
+
+  /* Append data to the queue, copying it.  If nothing is pending, and
+     the queue is not corked, the data are written straight away, and
+     only the remainder is kept.  Return negative on error, with errno
+     set to the error that stopped the queue. */
+  int react_outqwrite(react_outq_t, const void *, size_t);
+
+  /* Cork (on != 0) or uncork the queue.  While corked, data are only
+     appended, so that many small writes can be gathered into one
+     writev().  Uncorking writes out what it can.  Return negative on
+     error, as for react_outqwrite(). */
+  int react_outqcork(react_outq_t, int on);
+
+  /* Get the number of bytes not yet written. */
+  size_t react_outqpending(react_outq_t);
+
+  /* Get the error that stopped the queue, or zero. */
+  int react_outqerror(react_outq_t);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
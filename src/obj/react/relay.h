@@ -0,0 +1,71 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_relay_HDRINCLUDED
+#define react_relay_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "features.h"
+#include "types.h"
+
+#if react_ALLOW_FDSPLICE
+  /* This is an opaque handle for a relay, which moves data in both
+     directions between two descriptors through a pair of pipes, so
+     that it is never copied into user space.  react_RELAYERROR
+     symbolizes a permanent invalid value. */
+  typedef struct react_relaystr *react_relay_t;
+#define react_RELAYERROR ((struct react_relaystr *) 0)
+
+  /* Start relaying between two descriptors, at least one of which
+     must be a socket, and which are made non-blocking.  If 'pipesize'
+     is not zero, the pipes are resized to it.  Return
+     react_RELAYERROR on error, with errno set. */
+  react_relay_t react_openrelay(react_core_t, int fd_a, int fd_b,
+                                size_t pipesize);
+
+  /* Stop relaying, and release the pipes.  The descriptors are left
+     open.  Any handle primed on the relay is cancelled. */
+  void react_closerelay(react_relay_t);
+
+  /* Prime a handle to be triggered when both directions have ended,
+     or one has failed, in which case *en is set to the error.  An end
+     of stream from one descriptor is passed to the other with
+     shutdown(), once everything before it has been delivered. */
+  int react_prime_relay(react_t, react_relay_t, int *en);
+
+  /* Get the number of bytes delivered from a to b, and from b to a.
+     Either pointer may be null. */
+  void react_relaycounts(react_relay_t,
+                         unsigned long long *a2b, unsigned long long *b2a);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -31,6 +31,17 @@ extern "C" {
   int react_prime_intr(struct react_reg *r);
 #endif
 
+#if react_ALLOW_SIGNALFD
+#include <signal.h>
+
+  /* Prime a handle to be queued when signal 'signo' arrives, and
+     store its details in '*info'.  The signal is blocked in the
+     calling thread, and should be blocked in all others.  Return
+     negative on error, with errno == react_EEVENTINUSE if another
+     handle of the core is already waiting for the signal. */
+  int react_prime_signal(struct react_reg *r, int signo, siginfo_t *info);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,8 @@
  *  Contact Steven Simpson <https://github.com/simpsonst>
  */
 
+#include <stddef.h>
+
 #include "types.h"
 
 #ifdef __cplusplus
@@ -41,6 +43,15 @@ extern "C" {
   int react_prime_send(struct react_reg *, react_sock_t,
                        const void *, react_buflen_t, int,
                        react_ssize_t *, int *en);
+#if react_ALLOW_TIMESPEC
+  /* Like react_prime_recv(), but give up at a deadline, setting
+     *expired non-zero.  See react_deadline_timespec(). */
+  struct timespec;
+  int react_prime_recv_deadline(struct react_reg *, react_sock_t,
+                                void *, react_buflen_t, int,
+                                const struct timespec *when,
+                                react_ssize_t *, int *en, int *expired);
+#endif
 #if react_socklen_DEFINED
   int react_prime_sendto(struct react_reg *, react_sock_t,
                          const void *, react_buflen_t, int,
@@ -53,6 +64,20 @@ extern "C" {
 #endif // socklen
 #endif // buflen
 
+  /* Receive into a chain of buffers taken from a pool (see
+     <react/bufpool.h>), appending to *chain, until the socket would
+     block, the peer closes, an error occurs, or 'budget' bytes have
+     been received (unless zero).  *rc is the number of bytes
+     received, and *en is EAGAIN or EWOULDBLOCK if more may follow, 0
+     at end of stream, or the error that stopped reception.  The
+     socket should be non-blocking. */
+  struct react_buf;
+  struct react_bufpoolstr;
+  int react_prime_recvchain(struct react_reg *, react_sock_t,
+                            struct react_bufpoolstr *, size_t budget,
+                            int flags, struct react_buf **chain,
+                            react_ssize_t *rc, int *en);
+
 #if react_ALLOW_SOCKMSG
   struct msghdr;
   int react_prime_recvmsg(struct react_reg *r, react_sock_t sockfd,
@@ -61,6 +86,52 @@ extern "C" {
   int react_prime_sendmsg(struct react_reg *, react_sock_t,
                           const struct msghdr *, int flags,
                           react_ssize_t *, int *en);
+
+#if react_ALLOW_SOCKMMSG
+  /* Receive or send up to 'vlen' datagrams in one call when the
+     socket is ready.  *rc is the number completed, with their lengths
+     in each msg_len, or -1 on error. */
+  struct mmsghdr;
+  int react_prime_recvmmsg(struct react_reg *, react_sock_t,
+                           struct mmsghdr *, unsigned vlen, int flags,
+                           int *rc, int *en);
+  int react_prime_sendmmsg(struct react_reg *, react_sock_t,
+                           struct mmsghdr *, unsigned vlen, int flags,
+                           int *rc, int *en);
+#endif // sockmmsg
+
+#if react_ALLOW_UDPGSO && react_socklen_DEFINED && react_buflen_DEFINED
+  /* This describes a datagram received with react_prime_recvgro(). */
+  struct react_dgraminfo {
+    /* This is the number of bytes received, or -1 on error. */
+    react_ssize_t len;
+
+    /* This is the size of the datagrams that were coalesced into the
+       buffer, the last of which may be shorter, or 'len' if there was
+       only one. */
+    size_t segsize;
+
+    /* These are the flags from the received message header, e.g.,
+       MSG_TRUNC. */
+    int flags;
+  };
+
+  /* Send 'len' bytes as datagrams of 'segsize' bytes each, the last
+     possibly shorter, with one call, using UDP generic segmentation
+     offload. */
+  int react_prime_sendgso(struct react_reg *, react_sock_t,
+                          const void *, react_buflen_t, int flags,
+                          const struct sockaddr *, react_socklen_t,
+                          unsigned short segsize,
+                          react_ssize_t *rc, int *en);
+
+  /* Receive several datagrams from the same sender coalesced into one
+     buffer, if UDP_GRO has been enabled on the socket. */
+  int react_prime_recvgro(struct react_reg *, react_sock_t,
+                          void *, react_buflen_t, int flags,
+                          struct sockaddr *, react_socklen_t *,
+                          struct react_dgraminfo *info, int *en);
+#endif // udpgso
 #endif // sockmsg
 #endif // ssize
 
@@ -74,10 +145,32 @@ extern "C" {
                           struct sockaddr *, react_socklen_t *, int flags,
                           react_sock_t *, int *en);
 #endif
+
+  /* Accept up to 'max' connections on a non-blocking listening
+     socket, stopping early when no more are waiting.  'max' must not
+     be zero, or EINVAL is reported.  The new sockets
+     are stored in socks[0] to socks[*got - 1].  If 'addrs' is not
+     null, it is an array of 'max' addresses of 'addrsize' bytes each,
+     and their lengths are stored in addrlens.  Non-zero flags are
+     passed to accept4(), where available.  If none are accepted, *en
+     is set to the error. */
+  int react_prime_acceptmany(struct react_reg *, react_sock_t,
+                             int flags, size_t max, react_sock_t *socks,
+                             struct sockaddr *addrs,
+                             react_socklen_t addrsize,
+                             react_socklen_t *addrlens,
+                             size_t *got, int *en);
   int react_prime_connect(struct react_reg *, react_sock_t,
                           const struct sockaddr *, react_socklen_t,
                           int *rc, int *en);
 #endif // socklen
+
+#if react_ALLOW_BUSYPOLL
+  /* Let the kernel busy-poll the device queue for up to 'usecs'
+     microseconds when a read on the socket finds no data, by setting
+     SO_BUSY_POLL.  This is most useful with react_setspin(). */
+  int react_setbusypoll(react_sock_t, unsigned usecs);
+#endif
 #endif // sock
 #endif
 
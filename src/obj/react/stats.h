@@ -0,0 +1,163 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_stats_HDRINCLUDED
+#define react_stats_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "features.h"
+#include "types.h"
+
+  /* Counters only ever increase while the core exists, so a consumer
+     should compute rates by differencing successive snapshots. */
+  typedef unsigned long long react_count_t;
+
+  /* This is a snapshot of a core's runtime statistics.  Times are in
+     nanoseconds of the core's own clock. */
+  struct react_stats {
+    /* This names the system call used to wait for events, e.g.,
+       "ppoll", "select", "windows". */
+    const char *backend;
+
+    /* This is the number of calls to react_yield(). */
+    react_count_t yields;
+
+    /* This is the number of system calls made to wait for events.
+       Some platforms make several per yield. */
+    react_count_t waits;
+
+    /* This is the time spent waiting for events, and the time spent
+       triggering and processing handles after each wait.  These are
+       only accumulated while timing is enabled with react_profile(),
+       to keep clock readings out of untimed yields. */
+    react_count_t wait_ns, dispatch_ns;
+
+    /* These count handles activated by each source: system events
+       (descriptors, Windows handles, WIMP events), interrupts, timers
+       and idlers. */
+    struct {
+      react_count_t sys, intr, timed, idle;
+    } activated;
+
+    /* These count optimistic attempts at operations that completed
+       immediately, and those that would have blocked, so the handle
+       was primed as usual.  See react_optimistic(). */
+    struct {
+      react_count_t hits, misses;
+    } optimistic;
+
+    /* This describes spinning before waiting: the time spent, the
+       number of spins that detected events, the number that gave up
+       and waited, and the current spin limit.  See
+       react_setspin(). */
+    struct {
+      react_count_t ns, hits, misses;
+      unsigned long long budget_ns;
+    } spin;
+
+    /* This is the number of handles processed at each major
+       priority. */
+    react_count_t dispatched[react_MAXPRIOS];
+
+    /* This is the number of handles currently queued, and the most
+       that have been queued at once. */
+    size_t queued, queued_max;
+
+    /* These describe the system buffer passed to the waiting call, if
+       the platform has one, or are zero otherwise.  See the
+       definition of struct react_corestr. */
+    struct {
+      size_t size, lim, cap;
+    } sysbuf;
+  };
+
+  /* Copy a snapshot of the core's statistics to *sp. */
+  void react_getstats(struct react_corestr *, struct react_stats *sp);
+
+  /* This is the number of buckets in a latency histogram.  Bucket 0
+     counts zero-length intervals, and bucket i counts intervals of
+     [2^(i-1), 2^i) nanoseconds, except that the last bucket also
+     counts everything longer. */
+#define react_HISTBUCKETS 32
+
+  struct react_hist {
+    /* This is the number of intervals recorded, their total length,
+       and the longest of them. */
+    react_count_t count, sum_ns, max_ns;
+
+    react_count_t bucket[react_HISTBUCKETS];
+  };
+
+  /* Enable (on != 0) or disable timing of each handle's procedure,
+     and of waiting and dispatching in each yield.  Histograms are
+     discarded when disabled.  Return negative on
+     error, with errno == react_ENOMEM if out of memory. */
+  int react_profile(struct react_corestr *, int on);
+
+  /* Copy the histogram of procedure times for handles of major
+     priority p to *hp.  Return negative on error, with errno == EDOM
+     if p is out of range, or react_EBADSTATE if timing is
+     disabled. */
+  int react_getprofile(struct react_corestr *, react_prio_t p,
+                       struct react_hist *hp);
+
+  /* Attach a label to a handle, to identify it to the slow-procedure
+     hook.  The string is not copied, so must outlive the handle or
+     the next call.  The default is a null pointer. */
+  void react_label(struct react_reg *, const char *);
+  const char *react_getlabel(struct react_reg *);
+
+  /* This is invoked after a handle's procedure took at least the
+     configured time while timing is enabled.  The handle might
+     already have been closed by its procedure, so use it only to
+     identify the culprit. */
+  typedef void react_slowproc_t(void *ctxt, struct react_reg *,
+                                const char *label, react_count_t ns);
+
+  /* Set the hook for slow procedures, or remove it with a null
+     function. */
+  void react_onslow(struct react_corestr *, react_count_t threshold_ns,
+                    react_slowproc_t *func, void *ctxt);
+
+  /* Copy the histogram of how late timed handles have been triggered
+     relative to the times they were primed with. */
+  void react_gettimerlag(struct react_corestr *, struct react_hist *hp);
+
+  /* Copy the histogram of delays between the core waking to find
+     each handle queued and its procedure starting, including any
+     yields that it remained queued for.  While timing is disabled, the
+     start is taken as when the core woke for the yield that processes
+     the handle, so the time spent on handles processed before it in
+     the same yield is not included. */
+  void react_getwakelag(struct react_corestr *, struct react_hist *hp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
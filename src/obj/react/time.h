@@ -35,6 +35,17 @@ extern "C" {
 #if react_ALLOW_TIMESPEC
   struct timespec;
   int react_prime_timespec(struct react_reg *, const struct timespec *);
+
+  /* Give a handle that has just been primed on something else a
+     deadline.  If the deadline passes first, the handle is triggered
+     without its condition having been met, and *expired is set
+     non-zero.  Otherwise, *expired is set to zero.  Priming or
+     cancelling the handle again removes the deadline, but re-priming
+     done internally by the library keeps it.  Return
+     negative on error, with errno == react_EBADSTATE if the handle is
+     not primed. */
+  int react_deadline_timespec(struct react_reg *, const struct timespec *,
+                              int *expired);
 #endif
 
 #if react_ALLOW_WINFILETIME
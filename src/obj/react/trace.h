@@ -0,0 +1,113 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_trace_HDRINCLUDED
+#define react_trace_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "features.h"
+#include "types.h"
+
+  /* These identify the type of a trace record. */
+  enum {
+    /* react_yield() has been entered.  The argument is zero. */
+    react_TYIELDBEGIN,
+
+    /* react_yield() is about to return.  The argument is its return
+       value. */
+    react_TYIELDEND,
+
+    /* A system event has activated a handle.  The argument is the
+       descriptor, where that makes sense, or a platform-specific
+       code. */
+    react_TSYSEVENT,
+
+    /* A timed handle has been activated.  The argument is how late
+       it is in nanoseconds. */
+    react_TTIMER,
+
+    /* A handle has been queued.  The argument is its major
+       priority. */
+    react_TQUEUED,
+
+    /* A handle's procedure is about to be invoked, or has just
+       returned.  The argument is the handle's major priority. */
+    react_TPROCBEGIN,
+    react_TPROCEND,
+
+    react_T_MAX
+  };
+
+  /* This is a single fixed-size trace record. */
+  struct react_tracerec {
+    /* This is when the record was made, in nanoseconds since the Unix
+       epoch. */
+    unsigned long long ns;
+
+    /* This identifies the handle concerned, or is zero.  It is just
+       the handle's address, and the handle might no longer exist. */
+    unsigned long long handle;
+
+    long long arg;
+    unsigned type;
+    unsigned reserved;
+  };
+
+  /* A dump begins with this header, followed by 'count' records of
+     'recsize' bytes each, all in the host's byte order. */
+  struct react_tracehdr {
+    char magic[8];
+    unsigned recsize, count;
+  };
+
+#define react_TRACEMAGIC "ReactTr1"
+
+  /* Start recording the most recent 'nrecs' trace records (rounded up
+     to a power of two), or stop recording if zero.  Existing records
+     are discarded.  Return negative on error, with errno ==
+     react_ENOMEM if out of memory. */
+  int react_trace(struct react_corestr *, size_t nrecs);
+
+  /* Copy upto 'max' of the most recent records, oldest first, into
+     'buf', and return how many were copied.  This may be called from
+     a thread other than the core's, while the core is running, but
+     not while react_trace() is being called. */
+  size_t react_gettrace(struct react_corestr *,
+                        struct react_tracerec *buf, size_t max);
+
+#ifdef BUFSIZ
+  /* Write the records in binary to a stream, preceded by a header.
+     Return negative on error. */
+  int react_dumptrace(struct react_corestr *, FILE *);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
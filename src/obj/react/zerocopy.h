@@ -0,0 +1,84 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#ifndef react_zerocopy_HDRINCLUDED
+#define react_zerocopy_HDRINCLUDED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "features.h"
+#include "types.h"
+
+#if react_ALLOW_ZEROCOPY
+#include <sys/types.h>
+
+  /* This is an opaque handle for a tracker of zero-copy transmissions
+     on a socket.  react_ZEROCOPYERROR symbolizes a permanent invalid
+     value. */
+  typedef struct react_zerocopystr *react_zerocopy_t;
+#define react_ZEROCOPYERROR ((struct react_zerocopystr *) 0)
+
+  /* Enable zero-copy transmission on a TCP or UDP socket, and start
+     tracking its completions.  Return react_ZEROCOPYERROR on error,
+     with errno set, e.g., to ENOPROTOOPT if the system does not
+     support it. */
+  react_zerocopy_t react_openzerocopy(react_core_t, int sock);
+
+  /* Stop tracking.  The socket is left open.  Any handle primed on
+     the tracker is cancelled. */
+  void react_closezerocopy(react_zerocopy_t);
+
+  /* Like react_prime_send(), but with MSG_ZEROCOPY, so the system
+     might still be reading from the buffer after the handle is
+     triggered.  Successful sends are numbered from zero, and the
+     buffer of send n must be left alone until the number completed
+     exceeds n. */
+  int react_prime_send_zerocopy(react_t, react_zerocopy_t,
+                                const void *, size_t, int flags,
+                                ssize_t *rc, int *en);
+
+  /* Prime a handle to be triggered when more sends have completed
+     since it was last triggered, or straight away if none are
+     outstanding, setting *done to the number completed.  *copied is
+     set non-zero if the system has had to copy any of them anyway.
+     It is also triggered if the socket reports an error without any
+     completions.  Either pointer may be null. */
+  int react_prime_zerocopy(react_t, react_zerocopy_t,
+                           unsigned long long *done, int *copied);
+
+  /* Get the number of successful sends, and the number completed.
+     Either pointer may be null. */
+  void react_zerocopycounts(react_zerocopy_t,
+                            unsigned long long *sent,
+                            unsigned long long *done);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
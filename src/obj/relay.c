@@ -0,0 +1,285 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/fd.h"
+#include "react/idle.h"
+#include "react/relay.h"
+
+#if react_ALLOW_FDSPLICE
+#include <fcntl.h>
+#include <sys/socket.h>
+
+/* Each direction is pumped directly, rather than with
+   react_prime_splice_dual(), as that makes one splice() per wake-up,
+   and in only one direction, so it takes about twice as much CPU per
+   byte.  This limits how many rounds of splicing one direction makes
+   before letting other handles run. */
+#define PUMP_ROUNDS 8
+
+struct react_relaystr {
+  /* This is primed on the relay, or null. */
+  struct react_reg *done;
+  int *en;
+
+  /* This is the first error, or zero. */
+  int err;
+  unsigned ended;
+
+  /* Data from fd[i] goes to fd[!i] through dir[i]. */
+  struct react_relaydir {
+    struct react_relaystr *relay;
+    int from, to;
+    int pipe[2];
+
+    /* One handle waits for the source to be readable, and the other
+       for the destination to be writable. */
+    struct react_reg *rd, *wr;
+
+    /* This is how many bytes are in the pipe, and how many it can
+       hold.  The pipe can become full with fewer bytes, so 'full'
+       notes that, and is cleared when the pipe is drained. */
+    size_t held, cap;
+    unsigned long long moved;
+    unsigned eof : 1, shut : 1, full : 1;
+  } dir[2];
+};
+
+static void finish(struct react_relaystr *rl, int err)
+{
+  if (err != 0 && rl->err == 0)
+    rl->err = err;
+  if (rl->done == NULL) return;
+  struct react_reg *r = rl->done;
+  if (rl->err != 0 && rl->en)
+    *rl->en = rl->err;
+  react_trigger(r);
+}
+
+static int pump(struct react_relaydir *d)
+{
+  const unsigned flags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+  for (int round = 0; round < PUMP_ROUNDS; round++) {
+    int progress = 0;
+
+    /* Move from the source into the pipe. */
+    if (!d->eof && !d->full && d->held < d->cap) {
+      ssize_t rc = splice(d->from, NULL, d->pipe[1], NULL,
+                          d->cap - d->held, flags);
+      if (rc > 0) {
+        d->held += rc;
+        progress = 1;
+      } else if (rc == 0) {
+        d->eof = 1;
+        progress = 1;
+      } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        /* Either the source is empty, or the pipe is full.  We can
+           only tell if the pipe is empty. */
+        if (d->held > 0)
+          d->full = 1;
+      } else if (errno != EINTR) {
+        return -1;
+      }
+    }
+
+    /* Move from the pipe into the destination. */
+    if (d->held > 0) {
+      ssize_t rc = splice(d->pipe[0], NULL, d->to, NULL, d->held, flags);
+      if (rc > 0) {
+        d->held -= rc;
+        d->moved += rc;
+        d->full = 0;
+        progress = 1;
+      } else if (rc < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+                 errno != EINTR) {
+        return -1;
+      }
+    }
+
+    if (!progress) break;
+  }
+
+  /* Pass on the end of the stream once the pipe is empty. */
+  if (d->eof && d->held == 0 && !d->shut) {
+    if (shutdown(d->to, SHUT_WR) < 0 && errno != ENOTSOCK &&
+        errno != ENOTCONN)
+      return -1;
+    d->shut = 1;
+    d->relay->ended++;
+    return 0;
+  }
+
+  /* Wait for whatever we couldn't do. */
+  if (!d->eof && !d->full && d->held < d->cap &&
+      !react_isactive(d->rd) && react_prime_fdin(d->rd, d->from) < 0)
+    return -1;
+  if (d->held > 0 &&
+      !react_isactive(d->wr) && react_prime_fdout(d->wr, d->to) < 0)
+    return -1;
+  return 0;
+}
+
+static void stop(struct react_relaystr *rl)
+{
+  for (int i = 0; i < 2; i++) {
+    react_cancel(rl->dir[i].rd);
+    react_cancel(rl->dir[i].wr);
+  }
+}
+
+static void on_ready(void *ctxt)
+{
+  struct react_relaydir *d = ctxt;
+  struct react_relaystr *rl = d->relay;
+  if (rl->err != 0) return;
+  if (pump(d) < 0) {
+    int en = errno;
+    stop(rl);
+    finish(rl, en);
+  } else if (rl->ended == 2) {
+    finish(rl, 0);
+  }
+}
+
+static void release(struct react_relaystr *rl)
+{
+  for (int i = 0; i < 2; i++) {
+    struct react_relaydir *d = &rl->dir[i];
+    react_close(d->rd);
+    react_close(d->wr);
+    if (d->pipe[0] >= 0) close(d->pipe[0]);
+    if (d->pipe[1] >= 0) close(d->pipe[1]);
+  }
+  free(rl);
+}
+
+struct react_relaystr *react_openrelay(struct react_corestr *core,
+                                       int fd_a, int fd_b, size_t pipesize)
+{
+  struct react_relaystr *rl = malloc(sizeof *rl);
+  if (rl == NULL) {
+    errno = react_ENOMEM;
+    return react_RELAYERROR;
+  }
+  rl->done = NULL;
+  rl->en = NULL;
+  rl->err = 0;
+  rl->ended = 0;
+  for (int i = 0; i < 2; i++) {
+    struct react_relaydir *d = &rl->dir[i];
+    d->relay = rl;
+    d->from = i ? fd_b : fd_a;
+    d->to = i ? fd_a : fd_b;
+    d->pipe[0] = d->pipe[1] = -1;
+    d->held = 0;
+    d->moved = 0;
+    d->eof = d->shut = d->full = 0;
+    d->rd = react_open(core);
+    d->wr = react_open(core);
+  }
+
+  for (int i = 0; i < 2; i++) {
+    struct react_relaydir *d = &rl->dir[i];
+    if (d->rd == react_ERROR || d->wr == react_ERROR)
+      goto error;
+    react_direct(d->rd, &on_ready, d);
+    react_direct(d->wr, &on_ready, d);
+    d->rd->internal = d->wr->internal = 1;
+    if (pipe2(d->pipe, O_NONBLOCK | O_CLOEXEC) < 0)
+      goto error;
+    if (pipesize > 0)
+      fcntl(d->pipe[1], F_SETPIPE_SZ, (int) pipesize);
+    int sz = fcntl(d->pipe[1], F_GETPIPE_SZ);
+    d->cap = sz > 0 ? sz : 65536;
+    int fl = fcntl(d->from, F_GETFL);
+    if (fl < 0 || fcntl(d->from, F_SETFL, fl | O_NONBLOCK) < 0)
+      goto error;
+  }
+
+  /* Move whatever we can straight away, and wait for the rest. */
+  for (int i = 0; i < 2; i++)
+    if (pump(&rl->dir[i]) < 0) {
+      int en = errno;
+      stop(rl);
+      rl->err = en;
+      break;
+    }
+  return rl;
+
+ error:
+  {
+    int en = errno;
+    release(rl);
+    errno = en;
+  }
+  return react_RELAYERROR;
+}
+
+void react_closerelay(struct react_relaystr *rl)
+{
+  if (rl == react_RELAYERROR) return;
+  if (rl->done)
+    react_cancel(rl->done);
+  release(rl);
+}
+
+static void defuse(struct react_reg *r)
+{
+  struct react_relaystr *rl = r->data.relay;
+  rl->done = NULL;
+}
+
+int react_prime_relay(struct react_reg *r, struct react_relaystr *rl,
+                      int *en)
+{
+  if (rl->done != NULL) {
+    errno = react_EEVENTINUSE;
+    return -1;
+  }
+
+  /* If we've already finished, just trigger straight away. */
+  if (rl->err != 0 || rl->ended == 2) {
+    if (rl->err != 0 && en)
+      *en = rl->err;
+    return react_prime_idle(r);
+  }
+
+  r->data.relay = rl;
+  r->defuse = &defuse;
+  r->act = &react_trigger;
+  rl->done = r;
+  rl->en = en;
+  return 0;
+}
+
+void react_relaycounts(struct react_relaystr *rl,
+                       unsigned long long *a2b, unsigned long long *b2a)
+{
+  if (a2b) *a2b = rl->dir[0].moved;
+  if (b2a) *b2a = rl->dir[1].moved;
+}
+#endif
@@ -27,6 +27,7 @@
 
 #include "common.h"
 #include "react/event.h"
+#include "react/signal.h"
 
 #if react_HAVE_SIGSET
 sigset_t *react_sigmask(struct react_corestr *core)
@@ -61,3 +62,184 @@ int react_prime_intr(struct react_reg *r)
   return 0;
 }
 #endif
+
+#if react_ALLOW_SIGNALFD
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/signalfd.h>
+
+#include "react/fd.h"
+#include "react/idle.h"
+
+/* This is the most signals read in one go. */
+#define READ_BATCH 16
+
+struct react_sigfd {
+  /* This is the signalfd, and the handle that watches it while at
+     least one handle is waiting for a signal. */
+  int fd;
+  struct react_reg *ev;
+  size_t waiting;
+
+  /* These are the signals given to the signalfd, and thus
+     blocked. */
+  sigset_t mask;
+
+  /* This is the handle waiting for each signal. */
+  struct react_reg *watch[NSIG];
+
+  /* These signals arrived while no handle waited for them.  Like
+     ordinary pending signals, only the latest of each is kept. */
+  sigset_t latched;
+  struct signalfd_siginfo info[NSIG];
+};
+
+static void convert(siginfo_t *to, const struct signalfd_siginfo *from)
+{
+  memset(to, 0, sizeof *to);
+  to->si_signo = from->ssi_signo;
+  to->si_errno = from->ssi_errno;
+  to->si_code = from->ssi_code;
+  to->si_pid = from->ssi_pid;
+  to->si_uid = from->ssi_uid;
+  if (from->ssi_signo == SIGCHLD)
+    to->si_status = from->ssi_status;
+  else
+    to->si_value.sival_ptr = (void *) (uintptr_t) from->ssi_ptr;
+}
+
+static void on_signals(void *ctxt)
+{
+  struct react_sigfd *sf = ctxt;
+  struct signalfd_siginfo buf[READ_BATCH];
+  ssize_t got;
+  do {
+    got = read(sf->fd, buf, sizeof buf);
+    if (got < 0) break;
+    for (size_t i = 0; i < got / sizeof buf[0]; i++) {
+      int signo = buf[i].ssi_signo;
+      if (signo <= 0 || signo >= NSIG) continue;
+      struct react_reg *r = sf->watch[signo];
+      if (r) {
+        convert(r->data.signal.info, &buf[i]);
+        react_trigger(r);
+      } else {
+        sf->info[signo] = buf[i];
+        sigaddset(&sf->latched, signo);
+      }
+    }
+  } while (got == sizeof buf);
+
+  if (sf->waiting > 0)
+    react_prime_fdin(sf->ev, sf->fd);
+}
+
+static struct react_sigfd *ensure_sigfd(struct react_corestr *core)
+{
+  if (core->sigfd) return core->sigfd;
+
+  struct react_sigfd *sf = malloc(sizeof *sf);
+  if (!sf) {
+    errno = react_ENOMEM;
+    return NULL;
+  }
+  static const struct react_sigfd null;
+  *sf = null;
+  sigemptyset(&sf->mask);
+  sigemptyset(&sf->latched);
+  sf->fd = signalfd(-1, &sf->mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (sf->fd < 0) {
+    free(sf);
+    return NULL;
+  }
+  sf->ev = react_open(core);
+  if (sf->ev == react_ERROR) {
+    close(sf->fd);
+    free(sf);
+    return NULL;
+  }
+  react_direct(sf->ev, &on_signals, sf);
+  sf->ev->internal = 1;
+  core->sigfd = sf;
+  return sf;
+}
+
+void react_closesigfd(struct react_corestr *core)
+{
+  struct react_sigfd *sf = core->sigfd;
+  if (!sf) return;
+  core->sigfd = NULL;
+  react_close(sf->ev);
+  close(sf->fd);
+  free(sf);
+}
+
+static void defuse_signal(struct react_reg *r)
+{
+  struct react_sigfd *sf = r->core->sigfd;
+  assert(sf->watch[r->data.signal.signo] == r);
+  sf->watch[r->data.signal.signo] = NULL;
+  if (--sf->waiting == 0)
+    react_cancel(sf->ev);
+}
+
+int react_prime_signal(struct react_reg *r, int signo, siginfo_t *info)
+{
+  if (signo <= 0 || signo >= NSIG) {
+    errno = react_EINVAL;
+    return -1;
+  }
+
+  react_cancel(r);
+  struct react_corestr *core = r->core;
+  struct react_sigfd *sf = ensure_sigfd(core);
+  if (!sf) return -1;
+  if (sf->watch[signo]) {
+    errno = react_EEVENTINUSE;
+    return -1;
+  }
+
+  if (!sigismember(&sf->mask, signo)) {
+    /* The signal must stay blocked, even while waiting, so that it
+       is only delivered through the descriptor.  It remains blocked
+       when no longer watched, so that none are lost between
+       primings. */
+    sigset_t one;
+    sigemptyset(&one);
+    sigaddset(&one, signo);
+    int rc = pthread_sigmask(SIG_BLOCK, &one, NULL);
+    if (rc != 0) {
+      errno = rc;
+      return -1;
+    }
+#if ENABLE_SIGMASK
+    sigaddset(&core->sigmask, signo);
+#endif
+    sigaddset(&sf->mask, signo);
+    if (signalfd(sf->fd, &sf->mask, 0) < 0) {
+      sigdelset(&sf->mask, signo);
+      return -1;
+    }
+  }
+
+  /* Deliver a signal that arrived while nobody was waiting. */
+  if (sigismember(&sf->latched, signo)) {
+    sigdelset(&sf->latched, signo);
+    convert(info, &sf->info[signo]);
+    return react_prime_idle(r);
+  }
+
+  if (sf->waiting == 0 && react_prime_fdin(sf->ev, sf->fd) < 0)
+    return -1;
+  sf->waiting++;
+  sf->watch[signo] = r;
+  r->data.signal.signo = signo;
+  r->data.signal.info = info;
+  r->act = &react_trigger;
+  r->defuse = &defuse_signal;
+  return 0;
+}
+#endif
@@ -29,13 +29,34 @@
 #include <sys/socket.h>
 #endif
 #include <errno.h>
+#include <string.h>
 
 #include "common.h"
 #include "react/socket.h"
 #include "react/fd.h"
+#include "react/bufpool.h"
 #include "react/idle.h"
 #include "react/event.h"
 #include "react/windows.h"
+#include "react/time.h"
+
+#if react_ALLOW_UDPGSO
+#include <stdint.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+/* These might be missing from older headers. */
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
 
 #if react_ALLOW_SOCK
 int react_prime_sock(struct react_reg *r, react_sock_t fd, react_iomode_t m)
@@ -102,48 +123,89 @@ static inline void setrsl(react_socklen_t *p, react_socklen_t v)
   if (p) *p = v;
 }
 
-static void on_recv(struct react_reg *r)
+/* Pass this flag to make an optimistic attempt at reception or
+   transmission non-blocking. */
+#ifdef MSG_DONTWAIT
+#define TRY_FLAGS MSG_DONTWAIT
+#else
+#define TRY_FLAGS 0
+#endif
+
+static void complete(struct react_reg *r,
+                     react_ssize_t rc, react_ssize_t *rcp)
 {
-  (*r->proact.act)(r);
-  react_ssize_t rc = recv(r->proact.sub.recv.fd,
-                          r->proact.sub.recv.buf,
-                          r->proact.sub.recv.len,
-                          r->proact.sub.recv.flags);
   if (rc < 0)
     setint(r->proact.en, errno);
-  setrsz(r->proact.sub.recv.rc, rc);
+  setrsz(rcp, rc);
   react_trigger(r);
 }
 
+static react_ssize_t do_recv(struct react_reg *r, int flags)
+{
+  return recv(r->proact.sub.recv.fd,
+              r->proact.sub.recv.buf,
+              r->proact.sub.recv.len,
+              r->proact.sub.recv.flags | flags);
+}
+
+static void on_recv(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete(r, do_recv(r, 0), r->proact.sub.recv.rc);
+}
+
 int react_prime_recv(struct react_reg *r, react_sock_t sockfd,
                      void *buf, react_buflen_t len, int flags,
                      react_ssize_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_recv, &r->proact.act);
   r->proact.sub.recv.fd = sockfd;
   r->proact.sub.recv.buf = buf;
   r->proact.sub.recv.len = len;
   r->proact.sub.recv.flags = flags;
   r->proact.sub.recv.rc = rc;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_recv(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_recv, &r->proact.act);
   return 0;
 }
 
+#if react_ALLOW_TIMESPEC
+int react_prime_recv_deadline(struct react_reg *r, react_sock_t sockfd,
+                              void *buf, react_buflen_t len, int flags,
+                              const struct timespec *when,
+                              react_ssize_t *rc, int *en, int *expired)
+{
+  int orc = react_prime_recv(r, sockfd, buf, len, flags, rc, en);
+  if (orc < 0) return orc;
+  orc = react_deadline_timespec(r, when, expired);
+  if (orc < 0)
+    react_cancel(r);
+  return orc;
+}
+#endif
+
+static react_ssize_t do_recvfrom(struct react_reg *r, int flags)
+{
+  return recvfrom(r->proact.sub.recv.fd,
+                  r->proact.sub.recv.buf,
+                  r->proact.sub.recv.len,
+                  r->proact.sub.recv.flags | flags,
+                  r->proact.sub.recv.addr,
+                  r->proact.sub.recv.addrlen);
+}
+
 static void on_recvfrom(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = recvfrom(r->proact.sub.recv.fd,
-                              r->proact.sub.recv.buf,
-                              r->proact.sub.recv.len,
-                              r->proact.sub.recv.flags,
-                              r->proact.sub.recv.addr,
-                              r->proact.sub.recv.addrlen);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.recv.rc, rc);
-  react_trigger(r);
+  complete(r, do_recvfrom(r, 0), r->proact.sub.recv.rc);
 }
 
 int react_prime_recvfrom(struct react_reg *r, react_sock_t sockfd,
@@ -151,9 +213,6 @@ int react_prime_recvfrom(struct react_reg *r, react_sock_t sockfd,
                          struct sockaddr *addr, react_socklen_t *addrlen,
                          react_ssize_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_recvfrom, &r->proact.act);
   r->proact.sub.recv.fd = sockfd;
   r->proact.sub.recv.buf = buf;
   r->proact.sub.recv.len = len;
@@ -162,6 +221,133 @@ int react_prime_recvfrom(struct react_reg *r, react_sock_t sockfd,
   r->proact.sub.recv.addr = addr;
   r->proact.sub.recv.addrlen = addrlen;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_recvfrom(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_recvfrom, &r->proact.act);
+  return 0;
+}
+
+static int eagain(int en)
+{
+  return en == EAGAIN || en == EWOULDBLOCK;
+}
+
+/* Receive into the chain until something stops us, returning the
+   number of bytes received, and setting *why to the reason. */
+static react_ssize_t do_recvchain(struct react_reg *r, int *why)
+{
+  struct react_bufpoolstr *pool = r->proact.sub.recvchain.pool;
+  size_t budget = r->proact.sub.recvchain.budget;
+
+  /* Find the end of the chain, as the last buffer might have room. */
+  struct react_buf **tail = r->proact.sub.recvchain.chain, *last = NULL;
+  while (*tail != NULL) {
+    last = *tail;
+    tail = &last->next;
+  }
+
+  /* A fresh buffer is only linked in once it holds something. */
+  struct react_buf *fresh = NULL;
+  react_ssize_t total = 0;
+  for ( ; ; ) {
+    if (budget != 0 && (size_t) total >= budget) {
+      *why = EAGAIN;
+      break;
+    }
+    struct react_buf *b = last;
+    if (b == NULL || b->len == b->cap) {
+      if (fresh == NULL && (fresh = react_getbuf(pool)) == NULL) {
+        *why = errno;
+        break;
+      }
+      b = fresh;
+    }
+    size_t room = b->cap - b->len;
+    if (budget != 0 && room > budget - total)
+      room = budget - total;
+    react_ssize_t got = recv(r->proact.sub.recvchain.fd,
+                             (void *) (b->base + b->len), (react_buflen_t) room,
+                             r->proact.sub.recvchain.flags | TRY_FLAGS);
+    if (got < 0) {
+      if (errno == EINTR) continue;
+      *why = errno;
+      break;
+    }
+    if (got == 0) {
+      *why = 0;
+      break;
+    }
+    if (b == fresh) {
+      *tail = last = fresh;
+      tail = &fresh->next;
+      fresh = NULL;
+    }
+    b->len += got;
+    total += got;
+  }
+  react_putbufs(pool, fresh);
+  return total;
+}
+
+static void complete_chain(struct react_reg *r, react_ssize_t total, int why)
+{
+  setint(r->proact.en, why);
+  setrsz(r->proact.sub.recvchain.rc, total);
+  react_trigger(r);
+}
+
+static void on_recvchain(struct react_reg *r)
+{
+  struct react_deadline dl;
+  react_savedeadline(r, &dl);
+  (*r->proact.act)(r);
+  int why;
+  react_ssize_t total = do_recvchain(r, &why);
+  if (total == 0 && eagain(why)) {
+    /* Nothing was ready after all, so wait again, still bound by any
+       deadline. */
+    int orc = react_prime_sock(r, r->proact.sub.recvchain.fd, react_MIN);
+    if (orc == 0) {
+      react_swapact(r, &on_recvchain, &r->proact.act);
+      react_restoredeadline(r, &dl);
+      return;
+    }
+    why = errno;
+  }
+  complete_chain(r, total, why);
+}
+
+int react_prime_recvchain(struct react_reg *r, react_sock_t sockfd,
+                          struct react_bufpoolstr *pool, size_t budget,
+                          int flags, struct react_buf **chain,
+                          react_ssize_t *rc, int *en)
+{
+  r->proact.sub.recvchain.fd = sockfd;
+  r->proact.sub.recvchain.pool = pool;
+  r->proact.sub.recvchain.budget = budget;
+  r->proact.sub.recvchain.flags = flags;
+  r->proact.sub.recvchain.chain = chain;
+  r->proact.sub.recvchain.rc = rc;
+  r->proact.en = en;
+  if (r->optimistic) {
+    int why;
+    react_ssize_t total = do_recvchain(r, &why);
+    errno = why;
+    if (!react_wouldblock(r, total == 0)) {
+      complete_chain(r, total, why);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_recvchain, &r->proact.act);
   return 0;
 }
 
@@ -172,48 +358,57 @@ int react_prime_recvfrom(struct react_reg *r, react_sock_t sockfd,
 
 
 
+static react_ssize_t do_send(struct react_reg *r, int flags)
+{
+  return send(r->proact.sub.send.fd,
+              r->proact.sub.send.buf,
+              r->proact.sub.send.len,
+              r->proact.sub.send.flags | flags);
+}
+
 static void on_send(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = send(r->proact.sub.send.fd,
-                          r->proact.sub.send.buf,
-                          r->proact.sub.send.len,
-                          r->proact.sub.send.flags);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.send.rc, rc);
-  react_trigger(r);
+  complete(r, do_send(r, 0), r->proact.sub.send.rc);
 }
 
 int react_prime_send(struct react_reg *r, react_sock_t sockfd,
                      const void *buf, react_buflen_t len, int flags,
                      react_ssize_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_send, &r->proact.act);
   r->proact.sub.send.fd = sockfd;
   r->proact.sub.send.buf = buf;
   r->proact.sub.send.len = len;
   r->proact.sub.send.flags = flags;
   r->proact.sub.send.rc = rc;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_send(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MOUT);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_send, &r->proact.act);
   return 0;
 }
 
+static react_ssize_t do_sendto(struct react_reg *r, int flags)
+{
+  return sendto(r->proact.sub.send.fd,
+                r->proact.sub.send.buf,
+                r->proact.sub.send.len,
+                r->proact.sub.send.flags | flags,
+                r->proact.sub.send.addr,
+                r->proact.sub.send.addrlen);
+}
+
 static void on_sendto(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = sendto(r->proact.sub.send.fd,
-                            r->proact.sub.send.buf,
-                            r->proact.sub.send.len,
-                            r->proact.sub.send.flags,
-                            r->proact.sub.send.addr,
-                            r->proact.sub.send.addrlen);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.send.rc, rc);
-  react_trigger(r);
+  complete(r, do_sendto(r, 0), r->proact.sub.send.rc);
 }
 
 int react_prime_sendto(struct react_reg *r, react_sock_t sockfd,
@@ -221,9 +416,6 @@ int react_prime_sendto(struct react_reg *r, react_sock_t sockfd,
                        const struct sockaddr *addr, react_socklen_t addrlen,
                        react_ssize_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_sendto, &r->proact.act);
   r->proact.sub.send.fd = sockfd;
   r->proact.sub.send.buf = buf;
   r->proact.sub.send.len = len;
@@ -232,72 +424,328 @@ int react_prime_sendto(struct react_reg *r, react_sock_t sockfd,
   r->proact.sub.send.addr = addr;
   r->proact.sub.send.addrlen = addrlen;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_sendto(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MOUT);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_sendto, &r->proact.act);
   return 0;
 }
 
 #if react_ALLOW_SOCKMSG
+static react_ssize_t do_sendmsg(struct react_reg *r, int flags)
+{
+  return sendmsg(r->proact.sub.sendmsg.fd,
+                 r->proact.sub.sendmsg.msg,
+                 r->proact.sub.sendmsg.flags | flags);
+}
+
 static void on_sendmsg(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = sendmsg(r->proact.sub.sendmsg.fd,
-                             r->proact.sub.sendmsg.msg,
-                             r->proact.sub.sendmsg.flags);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.sendmsg.rc, rc);
-  react_trigger(r);
+  complete(r, do_sendmsg(r, 0), r->proact.sub.sendmsg.rc);
 }
 
 int react_prime_sendmsg(struct react_reg *r, react_sock_t sockfd,
                         const struct msghdr *msg, int flags,
                         react_ssize_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_sendmsg, &r->proact.act);
   r->proact.sub.sendmsg.fd = sockfd;
   r->proact.sub.sendmsg.msg = msg;
   r->proact.sub.sendmsg.flags = flags;
   r->proact.sub.sendmsg.rc = rc;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_sendmsg(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MOUT);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_sendmsg, &r->proact.act);
   return 0;
 }
 
+static react_ssize_t do_recvmsg(struct react_reg *r, int flags)
+{
+  return recvmsg(r->proact.sub.recvmsg.fd,
+                 r->proact.sub.recvmsg.msg,
+                 r->proact.sub.recvmsg.flags | flags);
+}
+
 static void on_recvmsg(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_ssize_t rc = recvmsg(r->proact.sub.recvmsg.fd,
-                             r->proact.sub.recvmsg.msg,
-                             r->proact.sub.recvmsg.flags);
-  if (rc < 0)
-    setint(r->proact.en, errno);
-  setrsz(r->proact.sub.recvmsg.rc, rc);
-  react_trigger(r);
+  complete(r, do_recvmsg(r, 0), r->proact.sub.recvmsg.rc);
 }
 
 int react_prime_recvmsg(struct react_reg *r, react_sock_t sockfd,
                         struct msghdr *msg, int flags,
                         react_ssize_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_recvmsg, &r->proact.act);
   r->proact.sub.recvmsg.fd = sockfd;
   r->proact.sub.recvmsg.msg = msg;
   r->proact.sub.recvmsg.flags = flags;
   r->proact.sub.recvmsg.rc = rc;
   r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_recvmsg(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_recvmsg, &r->proact.act);
+  return 0;
+}
+
+#if react_ALLOW_SOCKMMSG
+static void complete_mmsg(struct react_reg *r, int rc)
+{
+  if (rc < 0)
+    setint(r->proact.en, errno);
+  if (r->proact.sub.mmsg.rc)
+    *r->proact.sub.mmsg.rc = rc;
+  react_trigger(r);
+}
+
+static int do_recvmmsg(struct react_reg *r, int flags)
+{
+  return recvmmsg(r->proact.sub.mmsg.fd,
+                  r->proact.sub.mmsg.vec,
+                  r->proact.sub.mmsg.vlen,
+                  r->proact.sub.mmsg.flags | flags, NULL);
+}
+
+static void on_recvmmsg(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  /* Don't block waiting for a full vector once we've got one. */
+  complete_mmsg(r, do_recvmmsg(r, MSG_WAITFORONE));
+}
+
+int react_prime_recvmmsg(struct react_reg *r, react_sock_t sockfd,
+                         struct mmsghdr *vec, unsigned vlen, int flags,
+                         int *rc, int *en)
+{
+  r->proact.sub.mmsg.fd = sockfd;
+  r->proact.sub.mmsg.vec = vec;
+  r->proact.sub.mmsg.vlen = vlen;
+  r->proact.sub.mmsg.flags = flags;
+  r->proact.sub.mmsg.rc = rc;
+  r->proact.en = en;
+  if (r->optimistic) {
+    int got = do_recvmmsg(r, MSG_DONTWAIT);
+    if (!react_wouldblock(r, got < 0)) {
+      complete_mmsg(r, got);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_recvmmsg, &r->proact.act);
+  return 0;
+}
+
+static int do_sendmmsg(struct react_reg *r)
+{
+  /* Stop at the first datagram that doesn't fit, rather than
+     blocking with some already sent. */
+  return sendmmsg(r->proact.sub.mmsg.fd,
+                  r->proact.sub.mmsg.vec,
+                  r->proact.sub.mmsg.vlen,
+                  r->proact.sub.mmsg.flags | MSG_DONTWAIT);
+}
+
+static void on_sendmmsg(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete_mmsg(r, do_sendmmsg(r));
+}
+
+int react_prime_sendmmsg(struct react_reg *r, react_sock_t sockfd,
+                         struct mmsghdr *vec, unsigned vlen, int flags,
+                         int *rc, int *en)
+{
+  r->proact.sub.mmsg.fd = sockfd;
+  r->proact.sub.mmsg.vec = vec;
+  r->proact.sub.mmsg.vlen = vlen;
+  r->proact.sub.mmsg.flags = flags;
+  r->proact.sub.mmsg.rc = rc;
+  r->proact.en = en;
+  if (r->optimistic) {
+    int got = do_sendmmsg(r);
+    if (!react_wouldblock(r, got < 0)) {
+      complete_mmsg(r, got);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MOUT);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_sendmmsg, &r->proact.act);
   return 0;
 }
 #endif
 
+#if react_ALLOW_UDPGSO
+static react_ssize_t do_sendgso(struct react_reg *r, int flags)
+{
+  struct iovec iov = {
+    .iov_base = (void *) r->proact.sub.send.buf,
+    .iov_len = r->proact.sub.send.len,
+  };
+  union {
+    char buf[CMSG_SPACE(sizeof(uint16_t))];
+    struct cmsghdr align;
+  } ctrl;
+  struct msghdr msg = {
+    .msg_name = (void *) r->proact.sub.send.addr,
+    .msg_namelen = r->proact.sub.send.addrlen,
+    .msg_iov = &iov,
+    .msg_iovlen = 1,
+    .msg_control = ctrl.buf,
+    .msg_controllen = sizeof ctrl.buf,
+  };
+  struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+  cm->cmsg_level = SOL_UDP;
+  cm->cmsg_type = UDP_SEGMENT;
+  cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+  uint16_t segsize = r->proact.sub.send.segsize;
+  memcpy(CMSG_DATA(cm), &segsize, sizeof segsize);
+  return sendmsg(r->proact.sub.send.fd, &msg,
+                 r->proact.sub.send.flags | flags);
+}
+
+static void on_sendgso(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete(r, do_sendgso(r, 0), r->proact.sub.send.rc);
+}
+
+int react_prime_sendgso(struct react_reg *r, react_sock_t sockfd,
+                        const void *buf, react_buflen_t len, int flags,
+                        const struct sockaddr *addr, react_socklen_t addrlen,
+                        unsigned short segsize,
+                        react_ssize_t *rc, int *en)
+{
+  r->proact.sub.send.fd = sockfd;
+  r->proact.sub.send.buf = buf;
+  r->proact.sub.send.len = len;
+  r->proact.sub.send.flags = flags;
+  r->proact.sub.send.rc = rc;
+  r->proact.sub.send.addr = addr;
+  r->proact.sub.send.addrlen = addrlen;
+  r->proact.sub.send.segsize = segsize;
+  r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_sendgso(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got, rc);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MOUT);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_sendgso, &r->proact.act);
+  return 0;
+}
 
+static react_ssize_t do_recvgro(struct react_reg *r, int flags)
+{
+  struct react_dgraminfo *info = r->proact.sub.recv.info;
+  struct iovec iov = {
+    .iov_base = r->proact.sub.recv.buf,
+    .iov_len = r->proact.sub.recv.len,
+  };
+  union {
+    char buf[CMSG_SPACE(sizeof(int))];
+    struct cmsghdr align;
+  } ctrl;
+  struct msghdr msg = {
+    .msg_name = r->proact.sub.recv.addr,
+    .msg_namelen = r->proact.sub.recv.addrlen ?
+    *r->proact.sub.recv.addrlen : 0,
+    .msg_iov = &iov,
+    .msg_iovlen = 1,
+    .msg_control = ctrl.buf,
+    .msg_controllen = sizeof ctrl.buf,
+  };
+  react_ssize_t rc = recvmsg(r->proact.sub.recv.fd, &msg,
+                             r->proact.sub.recv.flags | flags);
+  info->len = rc;
+  if (rc < 0)
+    return rc;
+  setrsl(r->proact.sub.recv.addrlen, msg.msg_namelen);
+  info->flags = msg.msg_flags;
+
+  /* Without a segment size, there was only one datagram. */
+  info->segsize = rc;
+  for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+       cm = CMSG_NXTHDR(&msg, cm))
+    if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+      int segsize;
+      memcpy(&segsize, CMSG_DATA(cm), sizeof segsize);
+      info->segsize = segsize;
+    }
+  return rc;
+}
 
+static void complete_gro(struct react_reg *r, react_ssize_t rc)
+{
+  if (rc < 0)
+    setint(r->proact.en, errno);
+  react_trigger(r);
+}
 
-static void on_accept(struct react_reg *r)
+static void on_recvgro(struct react_reg *r)
 {
   (*r->proact.act)(r);
-  react_sock_t sock =
+  complete_gro(r, do_recvgro(r, 0));
+}
+
+int react_prime_recvgro(struct react_reg *r, react_sock_t sockfd,
+                        void *buf, react_buflen_t len, int flags,
+                        struct sockaddr *addr, react_socklen_t *addrlen,
+                        struct react_dgraminfo *info, int *en)
+{
+  r->proact.sub.recv.fd = sockfd;
+  r->proact.sub.recv.buf = buf;
+  r->proact.sub.recv.len = len;
+  r->proact.sub.recv.flags = flags;
+  r->proact.sub.recv.addr = addr;
+  r->proact.sub.recv.addrlen = addrlen;
+  r->proact.sub.recv.info = info;
+  r->proact.en = en;
+  if (r->optimistic) {
+    react_ssize_t got = do_recvgro(r, TRY_FLAGS);
+    if (!react_wouldblock(r, got < 0)) {
+      complete_gro(r, got);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_recvgro, &r->proact.act);
+  return 0;
+}
+#endif
+#endif
+
+
+
+
+static react_sock_t do_accept(struct react_reg *r)
+{
+  return
 #if react_ALLOW_ACCEPT4
     r->proact.sub.accept.flags != 0 ?
     accept4(r->proact.sub.accept.fd,
@@ -308,26 +756,48 @@ static void on_accept(struct react_reg *r)
     accept(r->proact.sub.accept.fd,
            r->proact.sub.accept.addr,
            r->proact.sub.accept.addrlen);
+}
+
+static void complete_accept(struct react_reg *r, react_sock_t sock)
+{
   if (sock == react_INVALID_SOCKET)
     setint(r->proact.en, errno);
   *r->proact.sub.accept.rc = sock;
   react_trigger(r);
 }
 
+static void on_accept(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete_accept(r, do_accept(r));
+}
+
+static int prime_accept(struct react_reg *r)
+{
+  if (r->optimistic) {
+    react_sock_t sock = do_accept(r);
+    if (!react_wouldblock(r, sock == react_INVALID_SOCKET)) {
+      complete_accept(r, sock);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, r->proact.sub.accept.fd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_accept, &r->proact.act);
+  return 0;
+}
+
 int react_prime_accept(struct react_reg *r, react_sock_t sockfd,
                        struct sockaddr *addr, react_socklen_t *addrlen,
                        react_sock_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_accept, &r->proact.act);
   r->proact.sub.accept.fd = sockfd;
   r->proact.sub.accept.rc = rc;
   r->proact.sub.accept.addr = addr;
   r->proact.sub.accept.addrlen = addrlen;
   r->proact.sub.accept.flags = 0;
   r->proact.en = en;
-  return 0;
+  return prime_accept(r);
 }
 
 #if react_ALLOW_ACCEPT4
@@ -336,18 +806,111 @@ int react_prime_accept4(struct react_reg *r, react_sock_t sockfd,
                         int flags,
                         react_sock_t *rc, int *en)
 {
-  int orc = react_prime_sock(r, sockfd, react_MIN);
-  if (orc < 0) return orc;
-  react_swapact(r, &on_accept, &r->proact.act);
   r->proact.sub.accept.fd = sockfd;
   r->proact.sub.accept.rc = rc;
   r->proact.sub.accept.addr = addr;
   r->proact.sub.accept.addrlen = addrlen;
   r->proact.sub.accept.flags = flags;
   r->proact.en = en;
-  return 0;
+  return prime_accept(r);
+}
+#endif
+
+/* Accept connections until the limit is reached or something stops
+   us, returning the number accepted. */
+static size_t do_acceptmany(struct react_reg *r)
+{
+  size_t n = 0;
+  while (n < r->proact.sub.acceptmany.max) {
+    struct sockaddr *addr = NULL;
+    react_socklen_t *addrlen = NULL;
+    if (r->proact.sub.acceptmany.addrs != NULL) {
+      addr = (struct sockaddr *)
+        ((char *) r->proact.sub.acceptmany.addrs +
+         n * r->proact.sub.acceptmany.addrsize);
+      addrlen = &r->proact.sub.acceptmany.addrlens[n];
+      *addrlen = r->proact.sub.acceptmany.addrsize;
+    }
+    react_sock_t sock =
+#if react_ALLOW_ACCEPT4
+      r->proact.sub.acceptmany.flags != 0 ?
+      accept4(r->proact.sub.acceptmany.fd, addr, addrlen,
+              r->proact.sub.acceptmany.flags) :
+#endif
+      accept(r->proact.sub.acceptmany.fd, addr, addrlen);
+    if (sock == react_INVALID_SOCKET) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    r->proact.sub.acceptmany.socks[n++] = sock;
+  }
+  return n;
 }
+
+static void complete_acceptmany(struct react_reg *r, size_t n)
+{
+  if (n == 0)
+    setint(r->proact.en, errno);
+  *r->proact.sub.acceptmany.got = n;
+  react_trigger(r);
+}
+
+static void on_acceptmany(struct react_reg *r)
+{
+  struct react_deadline dl;
+  react_savedeadline(r, &dl);
+  (*r->proact.act)(r);
+  size_t n = do_acceptmany(r);
+  if (n == 0 && eagain(errno)) {
+    /* The connection went away before we got to it, so wait again,
+       still bound by any deadline. */
+    int orc = react_prime_sock(r, r->proact.sub.acceptmany.fd, react_MIN);
+    if (orc == 0) {
+      react_swapact(r, &on_acceptmany, &r->proact.act);
+      react_restoredeadline(r, &dl);
+      return;
+    }
+  }
+  complete_acceptmany(r, n);
+}
+
+int react_prime_acceptmany(struct react_reg *r, react_sock_t sockfd,
+                           int flags, size_t max, react_sock_t *socks,
+                           struct sockaddr *addrs, react_socklen_t addrsize,
+                           react_socklen_t *addrlens,
+                           size_t *got, int *en)
+{
+  if (max == 0) {
+    errno = EINVAL;
+    return -1;
+  }
+#if !react_ALLOW_ACCEPT4
+  if (flags != 0) {
+    errno = EINVAL;
+    return -1;
+  }
 #endif
+  r->proact.sub.acceptmany.fd = sockfd;
+  r->proact.sub.acceptmany.flags = flags;
+  r->proact.sub.acceptmany.max = max;
+  r->proact.sub.acceptmany.socks = socks;
+  r->proact.sub.acceptmany.addrs = addrs;
+  r->proact.sub.acceptmany.addrsize = addrsize;
+  r->proact.sub.acceptmany.addrlens = addrlens;
+  r->proact.sub.acceptmany.got = got;
+  r->proact.en = en;
+  if (r->optimistic) {
+    size_t n = do_acceptmany(r);
+    if (!react_wouldblock(r, n == 0)) {
+      complete_acceptmany(r, n);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, sockfd, react_MIN);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_acceptmany, &r->proact.act);
+  return 0;
+}
 
 static void on_connect(struct react_reg *r)
 {
@@ -395,4 +958,17 @@ int react_prime_connect(struct react_reg *r, react_sock_t sockfd,
   r->proact.en = en;
   return 0;
 }
+
+#if react_ALLOW_BUSYPOLL
+int react_setbusypoll(react_sock_t sock, unsigned usecs)
+{
+#ifdef SO_BUSY_POLL
+  int val = usecs;
+  return setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof val);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+#endif
 #endif
@@ -0,0 +1,178 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+
+#include "common.h"
+#include "mytime.h"
+#include "react/stats.h"
+
+#if POLLCALL_PPOLL
+#define BACKEND_NAME "ppoll"
+#elif POLLCALL_POLL
+#define BACKEND_NAME "poll"
+#elif POLLCALL_PSELECT
+#define BACKEND_NAME "pselect"
+#elif POLLCALL_SELECT
+#define BACKEND_NAME "select"
+#elif POLLCALL_RISCOS
+#define BACKEND_NAME "riscos"
+#elif POLLCALL_WINDOWS
+#define BACKEND_NAME "windows"
+#else
+#error "No implementation"
+#endif
+
+void react_getstats(struct react_corestr *core, struct react_stats *sp)
+{
+  *sp = core->stats;
+  sp->backend = BACKEND_NAME;
+  sp->spin.budget_ns = core->spin.cur_ns;
+#if ARRAY_LIMIT > 0
+  sp->sysbuf.size = core->sysbuf.size;
+  sp->sysbuf.lim = core->sysbuf.lim;
+  sp->sysbuf.cap = core->sysbuf.cap;
+#endif
+}
+
+void react_histadd(struct react_hist *h, unsigned long long ns)
+{
+  h->count++;
+  h->sum_ns += ns;
+  if (ns > h->max_ns)
+    h->max_ns = ns;
+
+  /* The bucket is the number of significant bits. */
+  unsigned b;
+#ifdef __GNUC__
+  b = ns ? 64 - __builtin_clzll(ns) : 0;
+#else
+  for (b = 0; ns != 0; ns >>= 1)
+    b++;
+#endif
+  if (b >= react_HISTBUCKETS)
+    b = react_HISTBUCKETS - 1;
+  h->bucket[b]++;
+}
+
+int react_profile(struct react_corestr *core, int on)
+{
+  if (!on) {
+    free(core->prof);
+    core->prof = NULL;
+    return 0;
+  }
+
+  if (core->prof)
+    return 0;
+
+  core->prof = calloc(1, sizeof *core->prof);
+  if (core->prof == NULL) {
+    errno = react_ENOMEM;
+    return -1;
+  }
+  return 0;
+}
+
+int react_getprofile(struct react_corestr *core, react_prio_t p,
+                     struct react_hist *hp)
+{
+  if (p >= react_MAXPRIOS) {
+    errno = EDOM;
+    return -1;
+  }
+  if (core->prof == NULL) {
+    errno = react_EBADSTATE;
+    return -1;
+  }
+  *hp = core->prof->proc[p];
+  return 0;
+}
+
+void react_label(struct react_reg *r, const char *label)
+{
+  r->label = label;
+}
+
+const char *react_getlabel(struct react_reg *r)
+{
+  return r->label;
+}
+
+void react_onslow(struct react_corestr *core, react_count_t threshold_ns,
+                  react_slowproc_t *func, void *ctxt)
+{
+  core->slow.threshold = threshold_ns;
+  core->slow.func = func;
+  core->slow.ctxt = ctxt;
+}
+
+void react_gettimerlag(struct react_corestr *core, struct react_hist *hp)
+{
+  *hp = core->timer_lag;
+}
+
+void react_getwakelag(struct react_corestr *core, struct react_hist *hp)
+{
+  *hp = core->wake_lag;
+}
+
+void react_profproc(struct react_corestr *core, struct react_reg *r,
+                    react_prio_t p)
+{
+  /* The procedure might close its own handle, so get everything we
+     need from it first. */
+  react_proc_t *proc = r->proc;
+  void *proc_data = r->proc_data;
+  const char *label = r->label;
+
+  react_tracepoint(core, react_TPROCBEGIN, r, p);
+  if (core->prof == NULL) {
+    react_histadd(&core->wake_lag,
+                  react_systime_nsdiff(&core->woke, &r->queued_at));
+    (*proc)(proc_data);
+    react_tracepoint(core, react_TPROCEND, r, p);
+    return;
+  }
+
+  moment_type start, end;
+  if (react_systime_now(&start) < 0) {
+    (*proc)(proc_data);
+    react_tracepoint(core, react_TPROCEND, r, p);
+    return;
+  }
+  react_histadd(&core->wake_lag,
+                react_systime_nsdiff(&start, &r->queued_at));
+  (*proc)(proc_data);
+  react_tracepoint(core, react_TPROCEND, r, p);
+  if (react_systime_now(&end) < 0)
+    return;
+  unsigned long long ns = react_systime_nsdiff(&end, &start);
+
+  /* The procedure might also have disabled timing. */
+  if (core->prof)
+    react_histadd(&core->prof->proc[p], ns);
+  if (core->slow.func && ns >= core->slow.threshold)
+    (*core->slow.func)(core->slow.ctxt, r, label, ns);
+}
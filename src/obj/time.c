@@ -85,6 +85,30 @@ int react_systime_diff(delay_type *r,
   return 0;
 }
 
+unsigned long long react_systime_nsdiff(const moment_type *a,
+                                        const moment_type *b)
+{
+  ULARGE_INTEGER *ai = (void *) a;
+  ULARGE_INTEGER *bi = (void *) b;
+
+  if (ai->QuadPart < bi->QuadPart)
+    return 0;
+  return (ai->QuadPart - bi->QuadPart) * 100;
+}
+
+unsigned long long react_systime_ns(const moment_type *t)
+{
+  /* FILETIME counts 100ns intervals since 1601. */
+  ULARGE_INTEGER *ti = (void *) t;
+  return (ti->QuadPart - 116444736000000000ull) * 100;
+}
+
+void react_systime_addns(moment_type *t, unsigned long long ns)
+{
+  ULARGE_INTEGER *ti = (void *) t;
+  ti->QuadPart += ns / 100;
+}
+
 int react_systime_now(moment_type *spec)
 {
   GetSystemTimeAsFileTime(spec);
@@ -144,6 +168,30 @@ int react_systime_diff(delay_type *r,
   return 0;
 }
 
+unsigned long long react_systime_nsdiff(const moment_type *a,
+                                        const moment_type *b)
+{
+  delay_type d;
+  if (react_systime_diff(&d, a, b))
+    return 0;
+  return d.tv_sec * 1000000000ull + d.tv_nsec;
+}
+
+unsigned long long react_systime_ns(const moment_type *t)
+{
+  return t->tv_sec * 1000000000ull + t->tv_nsec;
+}
+
+void react_systime_addns(moment_type *t, unsigned long long ns)
+{
+  t->tv_sec += ns / 1000000000u;
+  t->tv_nsec += ns % 1000000000u;
+  if (t->tv_nsec >= 1000000000) {
+    t->tv_sec++;
+    t->tv_nsec -= 1000000000;
+  }
+}
+
 #if __STDC_VERSION__ >= 201112L
 /* struct timespec is now a standard type. */
 int react_systime_now(moment_type *spec)
@@ -202,6 +250,33 @@ int react_systime_now(moment_type *spec)
   return gettimeofday(spec, NULL);
 }
 
+unsigned long long react_systime_nsdiff(const moment_type *a,
+                                        const moment_type *b)
+{
+  long long d = a->tv_sec - b->tv_sec;
+  d *= 1000000;
+  d += a->tv_usec - b->tv_usec;
+  if (d < 0)
+    return 0;
+  return d * 1000ull;
+}
+
+unsigned long long react_systime_ns(const moment_type *t)
+{
+  return t->tv_sec * 1000000000ull + t->tv_usec * 1000ull;
+}
+
+void react_systime_addns(moment_type *t, unsigned long long ns)
+{
+  ns /= 1000;
+  t->tv_sec += ns / 1000000u;
+  t->tv_usec += ns % 1000000u;
+  if (t->tv_usec >= 1000000) {
+    t->tv_sec++;
+    t->tv_usec -= 1000000;
+  }
+}
+
 #ifdef TIMEFMT_TIMEVAL
 const char *react_systime_fmtdelay(const delay_type *d)
 {
@@ -0,0 +1,178 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#if __STDC_VERSION__ >= 201112L && !defined __STDC_NO_ATOMICS__
+#include <stdatomic.h>
+#define HAVE_ATOMICS 1
+#endif
+
+#include "common.h"
+#include "mytime.h"
+#include "react/trace.h"
+
+/* The ring is written only by the core's thread, so only the head
+   index needs to be published.  A reader copies records, then checks
+   that the writer has not overtaken them while it was copying. */
+struct react_trace {
+#if HAVE_ATOMICS
+  _Atomic unsigned long long head;
+#else
+  volatile unsigned long long head;
+#endif
+  size_t mask;
+  struct react_tracerec rec[];
+};
+
+static unsigned long long get_head(struct react_trace *t)
+{
+#if HAVE_ATOMICS
+  return atomic_load_explicit(&t->head, memory_order_acquire);
+#else
+  return t->head;
+#endif
+}
+
+int react_trace(struct react_corestr *core, size_t nrecs)
+{
+  free(core->trace);
+  core->trace = NULL;
+  if (nrecs == 0) return 0;
+
+  /* Round up to a power of two, so that indices can be masked. */
+  size_t cap = 1;
+  while (cap < nrecs) {
+    if (cap > ((size_t) -1 - sizeof *core->trace) / 2 /
+        sizeof core->trace->rec[0]) {
+      errno = react_ENOMEM;
+      return -1;
+    }
+    cap <<= 1;
+  }
+
+  struct react_trace *t =
+    malloc(sizeof *t + cap * sizeof t->rec[0]);
+  if (t == NULL) {
+    errno = react_ENOMEM;
+    return -1;
+  }
+#if HAVE_ATOMICS
+  atomic_init(&t->head, 0);
+#else
+  t->head = 0;
+#endif
+  t->mask = cap - 1;
+  core->trace = t;
+  return 0;
+}
+
+void react_tracerec(struct react_corestr *core, unsigned type,
+                    struct react_reg *r, long long arg)
+{
+  struct react_trace *t = core->trace;
+  int saved = errno;
+  moment_type now;
+  unsigned long long ns = react_systime_now(&now) < 0 ? 0 :
+    react_systime_ns(&now);
+  errno = saved;
+
+#if HAVE_ATOMICS
+  unsigned long long h =
+    atomic_load_explicit(&t->head, memory_order_relaxed);
+#else
+  unsigned long long h = t->head;
+#endif
+  struct react_tracerec *rec = &t->rec[h & t->mask];
+  rec->ns = ns;
+  rec->handle = (unsigned long long) (uintptr_t) r;
+  rec->arg = arg;
+  rec->type = type;
+  rec->reserved = 0;
+#if HAVE_ATOMICS
+  atomic_store_explicit(&t->head, h + 1, memory_order_release);
+#else
+  t->head = h + 1;
+#endif
+}
+
+size_t react_gettrace(struct react_corestr *core,
+                      struct react_tracerec *buf, size_t max)
+{
+  struct react_trace *t = core->trace;
+  if (t == NULL) return 0;
+
+  /* Work out which records are available. */
+  const unsigned long long cap = t->mask + 1;
+  unsigned long long end = get_head(t);
+  unsigned long long start = end > cap ? end - cap : 0;
+  if (end - start > max)
+    start = end - max;
+
+  for (unsigned long long i = start; i < end; i++)
+    buf[i - start] = t->rec[i & t->mask];
+
+  /* Discard any records that were overwritten while we were copying
+     them, including the one that might be being written now, in the
+     slot of record (now - cap). */
+#if HAVE_ATOMICS
+  atomic_thread_fence(memory_order_acquire);
+#endif
+  unsigned long long now = get_head(t);
+  if (now >= cap && now - cap + 1 > start) {
+    unsigned long long lost = now - cap + 1 - start;
+    if (lost >= end - start) return 0;
+    memmove(buf, buf + lost, (end - start - lost) * sizeof *buf);
+    start += lost;
+  }
+  return end - start;
+}
+
+int react_dumptrace(struct react_corestr *core, FILE *fp)
+{
+  size_t cap = core->trace ? core->trace->mask + 1 : 0;
+  struct react_tracerec *buf = NULL;
+  if (cap > 0) {
+    buf = malloc(cap * sizeof *buf);
+    if (buf == NULL) {
+      errno = react_ENOMEM;
+      return -1;
+    }
+  }
+  size_t count = react_gettrace(core, buf, cap);
+
+  struct react_tracehdr hdr;
+  memcpy(hdr.magic, react_TRACEMAGIC, sizeof hdr.magic);
+  hdr.recsize = sizeof *buf;
+  hdr.count = count;
+  int rc = 0;
+  if (fwrite(&hdr, sizeof hdr, 1, fp) != 1 ||
+      (count > 0 && fwrite(buf, sizeof *buf, count, fp) != count))
+    rc = -1;
+  free(buf);
+  return rc;
+}
@@ -0,0 +1,169 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+/* Decode a trace written by react_dumptrace(), either as a plain
+   timeline, or with -j as JSON for Chrome's trace viewer
+   (chrome://tracing or Perfetto). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include "react/trace.h"
+
+static const char *const names[] = {
+  [react_TYIELDBEGIN] = "yield",
+  [react_TYIELDEND] = "yield",
+  [react_TSYSEVENT] = "sysevent",
+  [react_TTIMER] = "timer",
+  [react_TQUEUED] = "queued",
+  [react_TPROCBEGIN] = "proc",
+  [react_TPROCEND] = "proc",
+};
+
+static const char *name_of(unsigned type)
+{
+  if (type < sizeof names / sizeof names[0] && names[type])
+    return names[type];
+  return "unknown";
+}
+
+static void print_text(const struct react_tracerec *rec, size_t count)
+{
+  unsigned depth = 0;
+  for (size_t i = 0; i < count; i++) {
+    const struct react_tracerec *r = &rec[i];
+    if (r->type == react_TYIELDEND || r->type == react_TPROCEND)
+      if (depth > 0) depth--;
+    printf("%12.3f %*s%s%s",
+           (r->ns - rec[0].ns) / 1000.0, (int) depth * 2, "",
+           name_of(r->type),
+           r->type == react_TYIELDBEGIN || r->type == react_TPROCBEGIN ?
+           " {" : r->type == react_TYIELDEND || r->type == react_TPROCEND ?
+           " }" : "");
+    if (r->handle)
+      printf(" %#llx", r->handle);
+    switch (r->type) {
+    case react_TSYSEVENT:
+      printf(" fd=%lld", r->arg);
+      break;
+    case react_TTIMER:
+      printf(" late=%lldns", r->arg);
+      break;
+    case react_TQUEUED:
+    case react_TPROCBEGIN:
+      printf(" prio=%lld", r->arg);
+      break;
+    case react_TYIELDEND:
+      printf(" rc=%lld", r->arg);
+      break;
+    }
+    putchar('\n');
+    if (r->type == react_TYIELDBEGIN || r->type == react_TPROCBEGIN)
+      depth++;
+  }
+}
+
+static void print_json(const struct react_tracerec *rec, size_t count)
+{
+  printf("{\"traceEvents\":[");
+  for (size_t i = 0; i < count; i++) {
+    const struct react_tracerec *r = &rec[i];
+    const char *ph;
+    switch (r->type) {
+    case react_TYIELDBEGIN:
+    case react_TPROCBEGIN:
+      ph = "B";
+      break;
+    case react_TYIELDEND:
+    case react_TPROCEND:
+      ph = "E";
+      break;
+    default:
+      ph = "i";
+      break;
+    }
+    printf("%s\n{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,"
+           "\"pid\":1,\"tid\":1%s,"
+           "\"args\":{\"handle\":\"%#llx\",\"arg\":%lld}}",
+           i > 0 ? "," : "", name_of(r->type), ph,
+           (r->ns - rec[0].ns) / 1000.0,
+           ph[0] == 'i' ? ",\"s\":\"t\"" : "",
+           r->handle, r->arg);
+  }
+  printf("\n]}\n");
+}
+
+int main(int argc, const char *const *argv)
+{
+  bool json = false;
+  const char *path = NULL;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "-j"))
+      json = true;
+    else if (path == NULL)
+      path = argv[i];
+    else {
+      fprintf(stderr, "usage: %s [-j] [file]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  FILE *fp = path ? fopen(path, "rb") : stdin;
+  if (fp == NULL) {
+    fprintf(stderr, "%s: %s\n", path, strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  struct react_tracehdr hdr;
+  if (fread(&hdr, sizeof hdr, 1, fp) != 1 ||
+      memcmp(hdr.magic, react_TRACEMAGIC, sizeof hdr.magic) != 0) {
+    fprintf(stderr, "%s: not a trace\n", path ? path : "-");
+    return EXIT_FAILURE;
+  }
+  if (hdr.recsize != sizeof(struct react_tracerec)) {
+    fprintf(stderr, "%s: record size %u (expected %zu)\n",
+            path ? path : "-", hdr.recsize, sizeof(struct react_tracerec));
+    return EXIT_FAILURE;
+  }
+
+  struct react_tracerec *rec = malloc(hdr.count * sizeof *rec + 1);
+  if (rec == NULL) {
+    perror("malloc");
+    return EXIT_FAILURE;
+  }
+  size_t count = fread(rec, sizeof *rec, hdr.count, fp);
+  if (count < hdr.count)
+    fprintf(stderr, "%s: truncated after %zu records\n",
+            path ? path : "-", count);
+  if (path) fclose(fp);
+
+  if (json)
+    print_json(rec, count);
+  else
+    print_text(rec, count);
+  free(rec);
+  return EXIT_SUCCESS;
+}
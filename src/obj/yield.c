@@ -34,6 +34,14 @@
 #include "common.h"
 #include "mytime.h"
 #include "fdextract.h"
+#include "react/event.h"
+#include "react/core.h"
+#include "react/fd.h"
+
+#if react_ALLOW_FD
+#include <unistd.h>
+#include <fcntl.h>
+#endif
 
 #if POLLCALL_RISCOS
 #include <riscos/wimp/events.h>
@@ -86,10 +94,12 @@ static rc_type wait_on_poll(struct react_corestr *core,
     }
   }
 
-  if (core->sysbuf.size == 0 && timeout == NULL && core->sig_ev == NULL)
+  if (core->sysbuf.size == core->run.waking && timeout == NULL &&
+      core->sig_ev == NULL)
     return WOULDBLOCK;
 
   int rc;
+  core->stats.waits++;
 #if POLLCALL_PPOLL
   rc = ppoll(core->sysbuf.base, core->sysbuf.lim, timeout, &core->sigmask);
 #else
@@ -102,6 +112,7 @@ static rc_type wait_on_poll(struct react_corestr *core,
     if (errno == EINTR) {
       struct react_reg *p = core->sig_ev;
       if (p) {
+        core->stats.activated.intr++;
         (*p->act)(p);
         return JUSTFINE;
       }
@@ -123,9 +134,14 @@ static rc_type wait_on_poll(struct react_corestr *core,
        has more than one. */
     core->sysbuf.idx = i;
     struct react_reg *p = core->sysbuf.ref_base[i].user.ev;
+    core->stats.activated.sys++;
+    react_tracepoint(core, react_TSYSEVENT, p, elem->fd);
     (*p->act)(p);
   }
-  assert(rc == 0);
+
+  /* We don't insist on finding all 'rc' entries, as a handle watching
+     several might have withdrawn some of them when notified of the
+     first. */
 
   return JUSTFINE;
 }
@@ -236,6 +252,8 @@ static void hunt_bad_fds(struct react_corestr *core)
       struct react_reg *r = core->fdmap.base[fd].elem[m];
       assert(r != NULL);
       core->fdsum.fd = fd;
+      core->stats.activated.sys++;
+      react_tracepoint(core, react_TSYSEVENT, r, fd);
       (*r->act)(r);
     } /* end of per-FD loop */
   } /* end of per-mode loop */
@@ -256,6 +274,8 @@ static void hunt_fd_events(struct react_corestr *core, fd_set *out_set)
       struct react_reg *r = core->fdmap.base[fd].elem[m];
       assert(r != NULL);
       core->fdsum.fd = fd;
+      core->stats.activated.sys++;
+      react_tracepoint(core, react_TSYSEVENT, r, fd);
       (*r->act)(r);
     } /* end of per-FD loop */
   } /* end of per-mode loop */
@@ -266,7 +286,7 @@ static void hunt_fd_events(struct react_corestr *core, fd_set *out_set)
 static rc_type wait_on_select(struct react_corestr *core,
                               delay_type *timeout)
 {
-  if (core->fdsum.count == 0 && timeout == NULL &&
+  if (core->fdsum.count == core->run.waking && timeout == NULL &&
       (core->sig_ev == NULL || core->sig_ev->queued))
     return WOULDBLOCK;
 
@@ -279,6 +299,7 @@ static rc_type wait_on_select(struct react_corestr *core,
 
   int used_max = core->fdsum.nfds;
   int rc;
+  core->stats.waits++;
 #if POLLCALL_PSELECT
   rc = pselect(used_max,
                &out_set[react_MIN],
@@ -303,6 +324,7 @@ static rc_type wait_on_select(struct react_corestr *core,
     if (errno == EINTR) {
       struct react_reg *p = core->sig_ev;
       if (p) {
+        core->stats.activated.intr++;
         (*p->act)(p);
         return JUSTFINE;
       }
@@ -427,6 +449,7 @@ static rc_type wait_on_riscos(struct react_corestr *core,
     assert(timeout != NULL);
     assert(timeout->tv_sec == 0);
     assert(timeout->tv_usec == 0);
+    core->stats.waits++;
     int rc = select(used_max,
                     &out_set[react_MIN],
                     &out_set[react_MOUT],
@@ -480,6 +503,7 @@ static rc_type wait_on_riscos(struct react_corestr *core,
     /* TODO: Check for kernel error. */
 
     /* Poll for WIMP events. */
+    core->stats.waits++;
     unsigned mask = core->wimp_mask;
     mask &= ~(1u << PollWord_NonZero);
     _kernel_oserror *ep;
@@ -520,6 +544,8 @@ static rc_type wait_on_riscos(struct react_corestr *core,
         unsigned bit = gb(&core->pwval);
         struct react_reg *r = core->pollword_event_handler[bit];
         if (r == NULL) continue;
+        core->stats.activated.sys++;
+        react_tracepoint(core, react_TSYSEVENT, r, bit);
         (*r->act)(r);
       }
 
@@ -534,6 +560,8 @@ static rc_type wait_on_riscos(struct react_corestr *core,
         assert((unsigned) core->ev_code < SIZEOFARR(core->wimp_event_handler));
         struct react_reg *evev = core->wimp_event_handler[core->ev_code];
         if (evev) {
+          core->stats.activated.sys++;
+          react_tracepoint(core, react_TSYSEVENT, evev, core->ev_code);
           (*evev->act)(evev);
         } else {
           /* TODO: Report an error? */
@@ -553,6 +581,8 @@ static rc_type wait_on_riscos(struct react_corestr *core,
         if (msgev == NULL)
           msgev = core->wimp_event_handler[core->ev_code];
         if (msgev) {
+          core->stats.activated.sys++;
+          react_tracepoint(core, react_TSYSEVENT, msgev, core->ev_code);
           (*msgev->act)(msgev);
         } else {
           /* TODO: Report an error? */
@@ -681,6 +711,7 @@ static rc_type wait_on_windows(struct react_corestr *core,
     } else {
       return WOULDBLOCK;
     }
+    core->stats.waits++;
 
     if (rsp == WAIT_FAILED) {
       /* This should never happen, but if it does, let's at least
@@ -767,10 +798,16 @@ static rc_type wait_on_windows(struct react_corestr *core,
      if the reactor handle had already been queued before entry, but
      that's okay, because the configured action is idempotent ("ensure
      we are queued"). */
-  if (!msg_ev_watch && core->msg_ev)
+  if (!msg_ev_watch && core->msg_ev) {
+    core->stats.activated.sys++;
+    react_tracepoint(core, react_TSYSEVENT, core->msg_ev, -1);
     (*core->msg_ev->act)(core->msg_ev);
-  if (!apc_ev_watch && core->apc_ev)
+  }
+  if (!apc_ev_watch && core->apc_ev) {
+    core->stats.activated.sys++;
+    react_tracepoint(core, react_TSYSEVENT, core->apc_ev, -1);
     (*core->apc_ev->act)(core->apc_ev);
+  }
 
   /* Scan the HANDLEs for the 'fire' flag.  The flags of only non-null
      HANDLEs should ever have been set. */
@@ -779,6 +816,8 @@ static rc_type wait_on_windows(struct react_corestr *core,
     if (p->fire) {
       p->fire = FALSE;
       assert(p->ev);
+      core->stats.activated.sys++;
+      react_tracepoint(core, react_TSYSEVENT, p->ev, i);
       (*p->ev->act)(p->ev);
     }
   }
@@ -805,19 +844,82 @@ static inline rc_type wait_on_system(struct react_corestr *core,
 #endif
 }
 
-static int detect_events(struct react_corestr *core)
+/* A spin shorter than this is not worth doing. */
+#define SPIN_MIN_NS 1000
+
+static react_count_t sys_activations(struct react_corestr *core)
+{
+  return core->stats.activated.sys + core->stats.activated.intr;
+}
+
+/* Adjust the spin after waiting for 'ns' nanoseconds.  If an event
+   arrived within the limit, a longer spin might have caught it,
+   otherwise spinning is wasted. */
+static void adapt_spin(struct react_corestr *core,
+                       unsigned long long ns, bool event)
 {
-  struct react_reg *first = bheap_peek(&core->timed);
+  if (event && ns <= core->spin.max_ns) {
+    if (core->spin.cur_ns < SPIN_MIN_NS)
+      core->spin.cur_ns = SPIN_MIN_NS;
+    else
+      core->spin.cur_ns *= 2;
+    if (core->spin.cur_ns > core->spin.max_ns)
+      core->spin.cur_ns = core->spin.max_ns;
+  } else if (ns > core->spin.max_ns) {
+    core->spin.cur_ns /= 2;
+    if (core->spin.cur_ns < SPIN_MIN_NS)
+      core->spin.cur_ns = 0;
+  }
+}
+
+/* Wait for and act on system events, or just act on those that have
+   already occurred if 'nowait'.  If *known is not set, the time at
+   which we started waiting is stored in *now, and *known is set, but
+   only if something needs it.  *waited is set if we might have
+   waited. */
+static int detect_events(struct react_corestr *core, moment_type *now,
+                         bool nowait, bool *known, bool *waited)
+{
+  /* Find the earliest timed event or deadline. */
+  const moment_type *first = NULL;
+  {
+    struct react_reg *r = bheap_peek(&core->timed);
+    if (r)
+      first = &r->data.systime.when;
+    r = bheap_peek(&core->deadlines);
+    if (r && (!first || react_systime_cmp(&r->deadline.when, first) < 0))
+      first = &r->deadline.when;
+
+    /* Don't wait beyond the end of a run loop. */
+    if (core->run.timed &&
+        (!first || react_systime_cmp(&core->run.until, first) < 0))
+      first = &core->run.until;
+  }
 
   delay_type delay, *timeout;
-  moment_type now;
+
+  /* What is the current time?  Without timed events, spinning or
+     timing, we don't need to know. */
+#if POLLCALL_RISCOS
+  const bool need_now = true;
+#else
+  const bool need_now = first || core->spin.max_ns > 0 || core->prof;
+#endif
+  if (!*known && need_now) {
+    if (react_systime_now(now) < 0)
+      return -1;
+    *known = true;
+  }
 
   /* Work out the maximum time we will have to wait. */
-  if (core->queues.top < core->queues.size || !dllist_isempty(&core->idlers)) {
+  bool immediate = false;
+  if (nowait || core->queues.top < core->queues.size ||
+      !dllist_isempty(&core->idlers)) {
     /* We have jobs to do straight away.  Idle events always fire, and
        we might have queued but unprocessed events left from the
        previous call. */
     react_systime_zero(timeout = &delay);
+    immediate = true;
 #if 0
     fprintf(stderr, "react: must act now\n");
 #endif
@@ -825,18 +927,14 @@ static int detect_events(struct react_corestr *core)
     /* Work out the extact delay. */
     timeout = &delay;
 
-    /* What is the current time? */
-    if (react_systime_now(&now) < 0)
-      return -1;
-
     /* How long until the first event? */
-    if (react_systime_diff(timeout, &first->data.systime.when, &now))
+    if (react_systime_diff(timeout, first, now))
       /* It's already overdue. */
       react_systime_zero(timeout);
 #if 0
     fprintf(stderr, "react: must act within %s by %s\n",
             react_systime_fmtdelay(timeout),
-            react_systime_fmt(&first->data.systime.when));
+            react_systime_fmt(first));
 #endif
   } else {
     /* If there are no pending events, no idlers, and no timed events,
@@ -847,7 +945,53 @@ static int detect_events(struct react_corestr *core)
 #endif
   }
 
-  switch (wait_on_system(core, timeout, &now)) {
+  *waited = !immediate;
+
+  /* Check for events without blocking for a while, before waiting
+     for them. */
+  moment_type from;
+  if (*known)
+    from = *now;
+  react_count_t seen = sys_activations(core);
+  if (core->spin.cur_ns > 0 && !immediate) {
+    unsigned long long spent;
+    bool due;
+    do {
+      delay_type zero;
+      react_systime_zero(&zero);
+      if (wait_on_system(core, &zero, now) == PROBLEM)
+        return -1;
+      if (react_systime_now(&from) < 0)
+        return -1;
+      spent = react_systime_nsdiff(&from, now);
+      due = first && react_systime_cmp(&from, first) >= 0;
+    } while (sys_activations(core) == seen && !due &&
+             spent < core->spin.cur_ns);
+    core->stats.spin.ns += spent;
+    if (sys_activations(core) != seen) {
+      core->stats.spin.hits++;
+      return 0;
+    }
+    core->stats.spin.misses++;
+    if (due)
+      return 0;
+
+    /* Don't wait beyond the first timed event. */
+    if (first && react_systime_diff(timeout, first, &from))
+      react_systime_zero(timeout);
+  }
+
+  rc_type rc = wait_on_system(core, timeout, now);
+
+  if (core->spin.max_ns > 0 && !immediate && rc != PROBLEM) {
+    moment_type woke;
+    if (react_systime_now(&woke) < 0)
+      return -1;
+    adapt_spin(core, react_systime_nsdiff(&woke, &from),
+               sys_activations(core) != seen);
+  }
+
+  switch (rc) {
   case WOULDBLOCK:
     errno = EAGAIN;
     return -1;
@@ -863,29 +1007,23 @@ static int detect_events(struct react_corestr *core)
   return 0;
 }
 
-int react_yield(struct react_corestr *core)
+/* Decide whether a run loop should process no more handles for
+   now, and count one more if not.  Internal handles are always
+   processed, and not counted. */
+static bool must_pause(struct react_corestr *core, struct react_reg *r)
 {
-  /* Detect and trigger/queue platform-specific events. */
-  if (detect_events(core) < 0) {
-    assert(errno != 0);
-    return -1;
+  if (!core->run.active || r->internal) return false;
+  if (atomic_load_explicit(&core->run.stop, memory_order_relaxed))
+    return true;
+  if (core->run.budgeted) {
+    if (core->run.left == 0) return true;
+    core->run.left--;
   }
+  return false;
+}
 
-  /* Notify any timed events that should have gone off by now. */
-  moment_type now;
-  if (react_systime_now(&now) < 0)
-    return -1;
-  for (struct react_reg *r = bheap_peek(&core->timed);
-       r != NULL &&
-         react_systime_cmp(&now, &r->data.systime.when) >= 0;
-       r = bheap_peek(&core->timed))
-    (*r->act)(r);
-
-  /* Notify all idlers. */
-  for (struct react_reg *r = dllist_first(&core->idlers);
-       r != NULL; r = dllist_first(&core->idlers))
-    (*r->act)(r);
-
+static void process_queues(struct react_corestr *core)
+{
   /* Process all events in the non-empty queue with the highest
      priority. */
 #if 0
@@ -912,7 +1050,7 @@ int react_yield(struct react_corestr *core)
 #if 0
           fprintf(stderr, "  Found future handle in %u/%u\n", p, sp);
 #endif
-          return 0;
+          return;
         }
       }
     } else {
@@ -927,11 +1065,24 @@ int react_yield(struct react_corestr *core)
 #if 0
           fprintf(stderr, "  Got %p\n", (void *) r);
 #endif
+          if (must_pause(core, r)) {
+            /* Leave the rest for later. */
+            core->queues.top = p;
+            return;
+          }
           assert(r->queued);
           dllist_unlink(&sq->base[sp], in_queue, r);
           r->queued = false;
+          core->stats.queued--;
+          core->stats.dispatched[p]++;
           react_defuse(r);
-          (*r->proc)(r->proc_data);
+          if (core->prof || core->trace) {
+            react_profproc(core, r, p);
+          } else {
+            react_histadd(&core->wake_lag,
+                          react_systime_nsdiff(&core->woke, &r->queued_at));
+            (*r->proc)(r->proc_data);
+          }
           found = true;
         }
       }
@@ -941,8 +1092,267 @@ int react_yield(struct react_corestr *core)
   /* We've processed all triggered events.  We don't need to check the
      queues again until more are triggered. */
   core->queues.top = core->queues.size;
+}
+
+/* Yield once.  If 'clock' is not null, it holds the current time, and
+   is updated to the time at which we finish. */
+static int yield_once(struct react_corestr *core, bool nowait,
+                      moment_type *clock)
+{
+  core->stats.yields++;
+  react_undefer(core);
+
+  /* Detect and trigger/queue platform-specific events. */
+  moment_type before;
+  bool known = clock != NULL, waited;
+  if (clock)
+    before = *clock;
+  if (detect_events(core, &before, nowait, &known, &waited) < 0) {
+    assert(errno != 0);
+    return -1;
+  }
+
+  /* Notify any timed events that should have gone off by now.  If we
+     only checked for events without waiting, the time we started is
+     recent enough. */
+  moment_type now;
+  if (!waited && known)
+    now = before;
+  else if (react_systime_now(&now) < 0)
+    return -1;
+  if (core->prof && known)
+    core->stats.wait_ns += react_systime_nsdiff(&now, &before);
+  core->woke = now;
+
+  /* Stamp handles queued since we last dispatched, and stamp any more
+     as they are queued. */
+  for (struct react_reg *r = dllist_first(&core->fresh);
+       r != NULL; r = dllist_first(&core->fresh)) {
+    dllist_unlink(&core->fresh, in_fresh, r);
+    r->fresh = 0;
+    r->queued_at = now;
+  }
+  core->dispatching = true;
+  for (struct react_reg *r = bheap_peek(&core->timed);
+       r != NULL &&
+         react_systime_cmp(&now, &r->data.systime.when) >= 0;
+       r = bheap_peek(&core->timed)) {
+    core->stats.activated.timed++;
+    unsigned long long late =
+      react_systime_nsdiff(&now, &r->data.systime.when);
+    react_histadd(&core->timer_lag, late);
+    react_tracepoint(core, react_TTIMER, r, late);
+    (*r->act)(r);
+  }
+
+  /* Trigger handles whose deadlines have passed, without performing
+     their actions. */
+  for (struct react_reg *r = bheap_peek(&core->deadlines);
+       r != NULL &&
+         react_systime_cmp(&now, &r->deadline.when) >= 0;
+       r = bheap_peek(&core->deadlines)) {
+    core->stats.activated.timed++;
+    react_tracepoint(core, react_TTIMER, r,
+                     react_systime_nsdiff(&now, &r->deadline.when));
+    bheap_remove(&core->deadlines, r);
+    r->deadline.set = 0;
+    if (r->deadline.expired)
+      *r->deadline.expired = 1;
+    react_trigger(r);
+  }
+
+  /* Notify all idlers. */
+  for (struct react_reg *r = dllist_first(&core->idlers);
+       r != NULL; r = dllist_first(&core->idlers)) {
+    core->stats.activated.idle++;
+    (*r->act)(r);
+  }
+
+  process_queues(core);
+  core->dispatching = false;
+
+  /* Account for the time spent acting on events, and tell a run loop
+     when we finished. */
+  if (clock || core->prof) {
+    moment_type after;
+    if (react_systime_now(&after) < 0)
+      return -1;
+    if (core->prof)
+      core->stats.dispatch_ns += react_systime_nsdiff(&after, &now);
+    if (clock)
+      *clock = after;
+  }
+
+  /* Let any outer loop know when we next have work to do. */
+  react_corefdpoint(core);
+  return 0;
+}
+
+static int yield(struct react_corestr *core, bool nowait,
+                 moment_type *clock)
+{
+  if (core->trace == NULL)
+    return yield_once(core, nowait, clock);
+
+  react_tracepoint(core, react_TYIELDBEGIN, NULL, 0);
+  int rc = yield_once(core, nowait, clock);
+  react_tracepoint(core, react_TYIELDEND, NULL, rc);
+  return rc;
+}
+
+int react_yield(struct react_corestr *core)
+{
+  return yield(core, false, NULL);
+}
+
+int react_yield_nowait(struct react_corestr *core)
+{
+  return yield(core, true, NULL);
+}
+
+#if react_ALLOW_FD
+static void on_wake(void *ctxt)
+{
+  struct react_corestr *core = ctxt;
+  unsigned char buf[64];
+  while (read(core->run.wake_in, buf, sizeof buf) > 0)
+    ;
+}
+
+static void act_wake(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  r->core->run.waking = false;
+}
+
+/* Create the pipe that react_stop() writes to. */
+static int ensure_wake(struct react_corestr *core)
+{
+  if (core->run.wake_in >= 0) return 0;
+
+  int fds[2];
+  if (pipe(fds) < 0)
+    return -1;
+  for (int i = 0; i < 2; i++) {
+    fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  core->run.ev = react_open(core);
+  if (core->run.ev == react_ERROR) {
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  }
+  react_direct(core->run.ev, &on_wake, core);
+  core->run.ev->internal = 1;
+  core->run.wake_in = fds[0];
+  atomic_store(&core->run.wake_out, fds[1]);
+  return 0;
+}
+
+/* Watch the pipe only if the next wait could block, as the stop
+   request is otherwise noticed between handles. */
+static int update_wake(struct react_corestr *core)
+{
+  bool busy = core->queues.top < core->queues.size ||
+    !dllist_isempty(&core->idlers) || !dllist_isempty(&core->deferred);
+  if (busy) {
+    if (core->run.waking) {
+      react_cancel(core->run.ev);
+      core->run.waking = false;
+    }
+    return 0;
+  }
+  if (core->run.waking) return 0;
+
+  if (react_prime_fdin(core->run.ev, core->run.wake_in) < 0)
+    return -1;
+  react_swapact(core->run.ev, &act_wake, &core->run.ev->proact.act);
+  core->run.waking = true;
   return 0;
 }
+#endif
+
+void react_closerun(struct react_corestr *core)
+{
+#if react_ALLOW_FD
+  if (core->run.wake_in < 0) return;
+  react_close(core->run.ev);
+  close(core->run.wake_in);
+  close(atomic_exchange(&core->run.wake_out, -1));
+  core->run.wake_in = -1;
+#endif
+}
+
+int react_run_for(struct react_corestr *core,
+                  unsigned long long ns, unsigned long max)
+{
+  if (core->run.active) {
+    errno = react_EBADSTATE;
+    return -1;
+  }
+
+  /* The clock is read at the end of processing, and that reading is
+     used to start the next iteration.  It is read again only after
+     waiting for events. */
+  moment_type clock;
+  if (react_systime_now(&clock) < 0)
+    return -1;
+#if react_ALLOW_FD
+  if (ensure_wake(core) < 0)
+    return -1;
+#endif
+  core->run.until = clock;
+  react_systime_addns(&core->run.until, ns);
+  core->run.timed = ns > 0;
+  core->run.budgeted = max > 0;
+  core->run.left = max;
+  core->run.active = true;
+
+  int rc = 0;
+  for ( ; ; ) {
+    if (atomic_exchange(&core->run.stop, false)) break;
+    if (core->run.budgeted && core->run.left == 0) break;
+    if (core->run.timed &&
+        react_systime_cmp(&clock, &core->run.until) >= 0) break;
+#if react_ALLOW_FD
+    if ((rc = update_wake(core)) < 0) break;
+#endif
+    if ((rc = yield(core, false, &clock)) < 0) break;
+  }
+
+#if react_ALLOW_FD
+  /* Stop watching the pipe, discard any wake-up still queued, and
+     empty the pipe, so that the core doesn't appear to have work. */
+  react_cancel(core->run.ev);
+  core->run.waking = false;
+  on_wake(core);
+  if (core->stats.queued == 0)
+    core->queues.top = core->queues.size;
+  react_corefdpoint(core);
+#endif
+  core->run.active = false;
+  core->run.timed = false;
+  core->run.budgeted = false;
+  return rc;
+}
+
+int react_run(struct react_corestr *core)
+{
+  return react_run_for(core, 0, 0);
+}
+
+void react_stop(struct react_corestr *core)
+{
+  atomic_store(&core->run.stop, true);
+#if react_ALLOW_FD
+  int fd = atomic_load(&core->run.wake_out);
+  if (fd >= 0) {
+    static const unsigned char one = 1;
+    (void) write(fd, &one, 1);
+  }
+#endif
+}
 
 
 /* TODO: Get rid of what's below.  We only keep it around to remind
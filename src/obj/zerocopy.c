@@ -0,0 +1,281 @@
+// -*- c-basic-offset: 2; indent-tabs-mode: nil -*-
+
+/*
+ *  React - Event reactor for C
+ *  Copyright (C) 2001,2004-6,2012,2014,2016-7  Lancaster University
+ *
+ *  This library is free software; you can redistribute it and/or
+ *  modify it under the terms of the GNU Lesser General Public
+ *  License as published by the Free Software Foundation; either
+ *  version 2.1 of the License, or (at your option) any later version.
+ *
+ *  This library is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *  Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Lesser General Public
+ *  License along with this library; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ *  Contact Steven Simpson <https://github.com/simpsonst>
+ */
+
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+#include "common.h"
+#include "react/event.h"
+#include "react/fd.h"
+#include "react/idle.h"
+#include "react/socket.h"
+#include "react/zerocopy.h"
+
+#if react_ALLOW_ZEROCOPY
+#include <stdint.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+
+/* These might be missing from older headers. */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+struct react_zerocopystr {
+  int sock;
+
+  /* This watches the error queue while sends are outstanding. */
+  struct react_reg *errq;
+  short got;
+
+  /* This is primed on the tracker, or null. */
+  struct react_reg *done;
+  unsigned long long *donep;
+  int *copiedp;
+
+  /* These count successful sends, those completed, and those
+     reported as completed. */
+  unsigned long long sent, completed, reported;
+  unsigned copied : 1;
+};
+
+static void notify(struct react_zerocopystr *zc)
+{
+  if (zc->done == NULL) return;
+  if (zc->donep) *zc->donep = zc->completed;
+  if (zc->copiedp) *zc->copiedp = zc->copied;
+  zc->reported = zc->completed;
+  react_trigger(zc->done);
+}
+
+static void watch(struct react_zerocopystr *zc)
+{
+  if (zc->completed == zc->sent || react_isactive(zc->errq)) return;
+  if (react_prime_poll(zc->errq, zc->sock, 0, &zc->got) < 0)
+    notify(zc);
+}
+
+/* Read completions from the error queue, and return non-zero if there
+   were any. */
+static int drain(struct react_zerocopystr *zc)
+{
+  int progress = 0;
+  for ( ; ; ) {
+    union {
+      char buf[CMSG_SPACE(sizeof(struct sock_extended_err) +
+                          sizeof(struct sockaddr_in6))];
+      struct cmsghdr align;
+    } ctrl;
+    struct msghdr msg = {
+      .msg_control = ctrl.buf,
+      .msg_controllen = sizeof ctrl.buf,
+    };
+    if (recvmsg(zc->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != NULL;
+         cm = CMSG_NXTHDR(&msg, cm)) {
+      if (!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) &&
+          !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+        continue;
+      struct sock_extended_err ee;
+      memcpy(&ee, CMSG_DATA(cm), sizeof ee);
+      if (ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY) continue;
+
+      /* Sends ee_info to ee_data inclusive have completed.  These
+         numbers are only 32 bits, so extend them relative to our
+         count. */
+      uint32_t back = (uint32_t) zc->sent - (ee.ee_data + 1u);
+      unsigned long long upto = zc->sent - back;
+      if (upto > zc->completed) {
+        zc->completed = upto;
+        progress = 1;
+      }
+      if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+        zc->copied = 1;
+    }
+  }
+  return progress;
+}
+
+static void on_errq(void *ctxt)
+{
+  struct react_zerocopystr *zc = ctxt;
+
+  /* If the socket became ready without completions, it has probably
+     failed, so don't keep watching until asked again. */
+  if (drain(zc))
+    watch(zc);
+  notify(zc);
+}
+
+struct react_zerocopystr *react_openzerocopy(struct react_corestr *core,
+                                             int sock)
+{
+  int one = 1;
+  if (setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof one) < 0)
+    return react_ZEROCOPYERROR;
+
+  struct react_zerocopystr *zc = malloc(sizeof *zc);
+  if (zc == NULL) {
+    errno = react_ENOMEM;
+    return react_ZEROCOPYERROR;
+  }
+  zc->errq = react_open(core);
+  if (zc->errq == react_ERROR) {
+    free(zc);
+    return react_ZEROCOPYERROR;
+  }
+  react_direct(zc->errq, &on_errq, zc);
+  zc->errq->internal = 1;
+  zc->sock = sock;
+  zc->got = 0;
+  zc->done = NULL;
+  zc->donep = NULL;
+  zc->copiedp = NULL;
+  zc->sent = zc->completed = zc->reported = 0;
+  zc->copied = 0;
+  return zc;
+}
+
+void react_closezerocopy(struct react_zerocopystr *zc)
+{
+  if (zc == react_ZEROCOPYERROR) return;
+  if (zc->done)
+    react_cancel(zc->done);
+  react_close(zc->errq);
+  free(zc);
+}
+
+static inline void setint(int *p, int v)
+{
+  if (p) *p = v;
+}
+
+static void complete(struct react_reg *r, ssize_t rc)
+{
+  if (rc < 0)
+    setint(r->proact.en, errno);
+  if (r->proact.sub.send.rc)
+    *r->proact.sub.send.rc = rc;
+  react_trigger(r);
+}
+
+static ssize_t do_send(struct react_reg *r, int flags)
+{
+  struct react_zerocopystr *zc = r->proact.sub.send.zc;
+  ssize_t rc = send(r->proact.sub.send.fd,
+                    r->proact.sub.send.buf,
+                    r->proact.sub.send.len,
+                    r->proact.sub.send.flags | MSG_ZEROCOPY | flags);
+  if (rc > 0) {
+    zc->sent++;
+    watch(zc);
+  }
+  return rc;
+}
+
+static void on_send(struct react_reg *r)
+{
+  (*r->proact.act)(r);
+  complete(r, do_send(r, 0));
+}
+
+int react_prime_send_zerocopy(struct react_reg *r,
+                              struct react_zerocopystr *zc,
+                              const void *buf, size_t len, int flags,
+                              ssize_t *rc, int *en)
+{
+  r->proact.sub.send.fd = zc->sock;
+  r->proact.sub.send.buf = buf;
+  r->proact.sub.send.len = len;
+  r->proact.sub.send.flags = flags;
+  r->proact.sub.send.rc = rc;
+  r->proact.sub.send.zc = zc;
+  r->proact.en = en;
+  if (r->optimistic) {
+    ssize_t got = do_send(r, MSG_DONTWAIT);
+    if (!react_wouldblock(r, got < 0)) {
+      complete(r, got);
+      return 0;
+    }
+  }
+  int orc = react_prime_sock(r, zc->sock, react_MOUT);
+  if (orc < 0) return orc;
+  react_swapact(r, &on_send, &r->proact.act);
+  return 0;
+}
+
+static void defuse(struct react_reg *r)
+{
+  struct react_zerocopystr *zc = r->data.zerocopy;
+  zc->done = NULL;
+}
+
+int react_prime_zerocopy(struct react_reg *r, struct react_zerocopystr *zc,
+                         unsigned long long *done, int *copied)
+{
+  if (zc->done != NULL) {
+    errno = react_EEVENTINUSE;
+    return -1;
+  }
+
+  /* If there are unreported completions, or nothing to wait for,
+     report straight away. */
+  if (zc->completed > zc->reported || zc->completed == zc->sent) {
+    if (done) *done = zc->completed;
+    if (copied) *copied = zc->copied;
+    zc->reported = zc->completed;
+    return react_prime_idle(r);
+  }
+
+  r->data.zerocopy = zc;
+  r->defuse = &defuse;
+  r->act = &react_trigger;
+  zc->done = r;
+  zc->donep = done;
+  zc->copiedp = copied;
+  watch(zc);
+  return 0;
+}
+
+void react_zerocopycounts(struct react_zerocopystr *zc,
+                          unsigned long long *sent,
+                          unsigned long long *done)
+{
+  if (sent) *sent = zc->sent;
+  if (done) *done = zc->completed;
+}
+#endif